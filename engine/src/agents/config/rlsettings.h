@@ -60,6 +60,36 @@ struct RLSettings
     float resignThreshold;
     // boolean indicating if the search tree is reused during selfplay game generation
     bool reuseTreeForSelpay;
+    // number of games which are generated concurrently in the same process. Their leaf nodes are evaluated in shared batches.
+    size_t concurrentGames;
+    // maximum time in microseconds to wait for further requests before an incompletely filled shared batch is evaluated
+    size_t sharedBatchTimeoutUS;
+    // exports the training samples in the compact format (bitboards, scalars and sparse policies) instead of zarr
+    bool compactExport;
+    // all self play processes on a host write into the shared zarr data set "data.zarr" (samples are reserved via "data.zarr.index"),
+    // the last writer renames the full data set to "data_<device>.zarr"
+    bool multiWriterExport;
+    // writes the pgn files as gzip streams (requires a build with USE_ZLIB)
+    bool compressPGN;
+    // interval in seconds in which the metrics file "metrics_<device>.prom" is rewritten after a finished game (0: disabled)
+    size_t metricsIntervalS;
+    // number of self play starting positions which are generated at once with batched raw network evaluations (0: one by one)
+    size_t openingPoolSize;
+    // adjudicates standard chess games by a WDL tablebase probe as soon as the piece count allows it (requires a SyzygyPath)
+    bool adjudicateTablebase;
+    // the game is adjudicated as a draw if |Q| of the best move stays below this threshold for drawAdjudicationPlies consecutive plies
+    float drawAdjudicationThreshold;
+    // number of consecutive plies for the draw adjudication (0: disabled)
+    size_t drawAdjudicationPlies;
+    // the game is adjudicated as a draw after this amount of plies (0: disabled)
+    size_t maxGamePlies;
+    // stops the arena as soon as the sequential probability ratio test accepts H0 (elo = sprtElo0) or H1 (elo = sprtElo1)
+    bool arenaSPRT;
+    float sprtElo0;
+    float sprtElo1;
+    // probability of a false positive / false negative decision
+    float sprtAlpha;
+    float sprtBeta;
 };
 
 #endif // RLSETTINGS_H
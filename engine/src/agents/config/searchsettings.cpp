@@ -49,7 +49,13 @@ SearchSettings::SearchSettings():
         threshCheck(0.1f),
         checkFactor(0.5f),
         threshCapture(0.02f),
-        captureFactor(0.05f)
+        captureFactor(0.05f),
+        logSearchStatistics(false),
+        compactTree(false),
+        compactLeafNodes(false),
+        policyMassThreshold(1.0f),
+        usePerfCounters(false),
+        threadAffinity(AFFINITY_NONE)
 {
 
 }
@@ -29,6 +29,7 @@
 #define SEARCHSETTINGS_H
 
 #include "uci.h"
+#include "../../util/affinity.h"
 
 using namespace UCI;
 
@@ -72,6 +73,23 @@ struct SearchSettings
     bool useSolver;
     // early break out based on max node visits in tree; increases time for falling eval
     bool useNPSTimemanager;
+    // prints the search counters and tree statistics at every log interval
+    bool logSearchStatistics;
+    // copies a reused subtree into new memory in breadth-first order before the search starts
+    bool compactTree;
+    // stores the prior policy of unvisited leaf nodes in half precision instead of their moves and their float policy
+    // (2 instead of at least 8 bytes per legal move). Every leaf still generates its moves once when its NN results are assigned
+    // and again on its second visit, and the board of every new leaf is kept until the NN results of its batch are assigned.
+    bool compactLeafNodes;
+    // policy mass which is covered by the stored moves of each expanded node, the remaining moves are regenerated when needed (1.0: disabled)
+    float policyMassThreshold;
+    // collects hardware performance counters for each search thread (only used by the benchmark)
+    bool usePerfCounters;
+    // placement of the search threads (including their inference calls), the thread manager and the logger on NUMA nodes
+    ThreadAffinity threadAffinity;
+    // CPUs of the search threads if the cores are partitioned between the tree search and the CPU inference
+    // (empty: no partitioning, threadAffinity is used instead)
+    vector<int> searchCpus;
     SearchSettings();
 
 };
@@ -24,6 +24,7 @@
  */
 
 #include <thread>
+#include <algorithm>
 #include "mctsagent.h"
 #include "../evalinfo.h"
 #include "movegen.h"
@@ -33,10 +34,15 @@
 #include "../util/blazeutil.h"
 #include "uci.h"
 #include "../manager/statesmanager.h"
+#include "util/searchstatistics.h"
+#include "../util/tracer.h"
+#include "../util/memorystatistics.h"
 #include "../manager/treemanager.h"
 #include "../manager/threadmanager.h"
 #include "../node.h"
 #include "../util/communication.h"
+#include "../util/lockstatistics.h"
+#include "../util/affinity.h"
 
 
 MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, vector<unique_ptr<NeuralNetAPI>>& netBatches,
@@ -55,13 +61,18 @@ MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, vector<unique_ptr<NeuralNetAPI>>&
     reusedFullTree(false),
     isRunning(false),
     overallNPS(0.0f),
-    nbNPSentries(0)
+    nbNPSentries(0),
+    startupLatencyUS(0)
 {
     mapWithMutex.hashTable.reserve(1e6);
+    memoryStatistics.add(MEM_HASH_TABLE, mapWithMutex.hashTable.bucket_count() * sizeof(void*));
 
     for (auto i = 0; i < searchSettings->threads; ++i) {
         searchThreads.emplace_back(new SearchThread(netBatches[i].get(), searchSettings, &mapWithMutex));
+        searchThreads.back()->set_search_budget(&searchBudget);
     }
+    // two additional workers for the thread manager and the logger
+    threadPool = make_unique<ThreadPool>(searchSettings->threads + 2);
     probOutputs = make_unique<float[]>(netSingle->get_policy_output_length());
     timeManager = make_unique<TimeManager>(searchSettings->randomMoveFactor);
     generator = default_random_engine(r());
@@ -73,6 +84,8 @@ MCTSAgent::~MCTSAgent()
     for (auto searchThread : searchThreads) {
         delete searchThread;
     }
+    memoryStatistics.add(MEM_HASH_TABLE, -int64_t(mapWithMutex.hashTable.bucket_count() * sizeof(void*) +
+                                                 mapWithMutex.hashTable.size() * hash_table_entry_bytes<HashTable>()));
 }
 
 Node* MCTSAgent::get_opponents_next_root() const
@@ -129,6 +142,9 @@ size_t MCTSAgent::init_root_node(Board *pos)
         // swap the states because now the old states are used
         // This way the memory won't be freed for the next new move
         states->swap_states();
+        rootNode->generate_deferred_moves(pos);
+        rootNode->restore_moves_and_policy(pos);
+        rootNode->expand_policy_tail(pos);
         nodesPreSearch = size_t(rootNode->get_visits());
         info_string(nodesPreSearch, "nodes of former tree will be reused");
     }
@@ -181,7 +197,7 @@ void MCTSAgent::create_new_root_node(Board *pos)
     board_to_planes(pos, pos->number_repetitions(), true, begin(inputPlanes));
     netSingle->predict(inputPlanes, &valueOutput, probOutputs.get());
     size_t tbHits = 0;
-    fill_nn_results(0, netSingle->is_policy_map(), &valueOutput, probOutputs.get(), rootNode, tbHits, pos->side_to_move(), searchSettings);
+    fill_nn_results(0, netSingle->is_policy_map(), &valueOutput, probOutputs.get(), rootNode, pos, tbHits, pos->side_to_move(), searchSettings);
     rootNode->prepare_node_for_visits();
 }
 
@@ -195,6 +211,19 @@ void MCTSAgent::delete_old_tree()
     }
 }
 
+void MCTSAgent::compact_root_tree()
+{
+    const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    Node* oldRootNode = rootNode;
+    rootNode = compact_tree(rootNode, mapWithMutex.hashTable);
+    // the remaining game nodes point to deleted or relocated nodes now
+    for (Node** gameNode : {&oldestRootNode, &ownNextRoot, &opponentsNextRoot}) {
+        *gameNode = *gameNode == oldRootNode ? rootNode : nullptr;
+    }
+    const size_t elapsedMS = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+    info_string("compacted the reused tree in", to_string(elapsedMS) + "ms");
+}
+
 void MCTSAgent::sleep_and_log_for(size_t timeMS, size_t updateIntervalMS)
 {
     if (!isRunning) {
@@ -222,6 +251,25 @@ size_t MCTSAgent::get_tb_hits()
     return tbHits;
 }
 
+size_t MCTSAgent::get_startup_latency_us() const
+{
+    return startupLatencyUS;
+}
+
+SearchCounters MCTSAgent::get_search_counters() const
+{
+    return ::get_search_counters(searchThreads);
+}
+
+vector<PerfValues> MCTSAgent::get_perf_values() const
+{
+    vector<PerfValues> perfValues;
+    for (auto searchThread : searchThreads) {
+        perfValues.emplace_back(searchThread->get_perf_values());
+    }
+    return perfValues;
+}
+
 void MCTSAgent::update_nps_measurement(float curNPS)
 {
     if (searchSettings->useNPSTimemanager) {
@@ -248,6 +296,7 @@ void MCTSAgent::clear_game_history()
     delete_old_tree();
 
     assert(mapWithMutex.hashTable->size() == 0);
+    memoryStatistics.add(MEM_HASH_TABLE, -int64_t(mapWithMutex.hashTable.size() * hash_table_entry_bytes<HashTable>()));
     mapWithMutex.hashTable.clear();
     oldestRootNode = nullptr;
     ownNextRoot = nullptr;
@@ -293,6 +342,9 @@ void MCTSAgent::evaluate_board_state()
         if (rootNode->get_parent_node() != nullptr) {
             rootNode->make_to_root();
         }
+        if (searchSettings->compactTree && evalInfo->nodesPreSearch != 0 && !reusedFullTree) {
+            compact_root_tree();
+        }
         info_string("run mcts search");
         run_mcts_search();
     }
@@ -303,28 +355,82 @@ void MCTSAgent::evaluate_board_state()
 
 void MCTSAgent::run_mcts_search()
 {
-    thread** threads = new thread*[searchSettings->threads];
+#ifdef LOCK_PROFILING
+    lockStatistics.reset();
+#endif
+    tracer.start_search();
+    const int curMovetime = timeManager->get_time_for_move(searchLimits, rootPos->side_to_move(), rootNode->plies_from_null()/2);
+    // the visits of a reused tree count towards the node limit
+    const size_t searchedNodes = rootNode->get_visits() - rootNode->get_terminal_visits();
+    searchBudget.reset(searchLimits->nodes > searchedNodes ? searchLimits->nodes - searchedNodes : 0, size_t(max(curMovetime, 0)));
+    if (searchLimits->nodes != 0 && searchedNodes >= searchLimits->nodes) {
+        searchBudget.stop();
+    }
+    const chrono::steady_clock::time_point dispatchTime = chrono::steady_clock::now();
+    vector<chrono::steady_clock::time_point> startTimes(searchSettings->threads);
+    vector<future<void>> searchJobs;
     for (size_t i = 0; i < searchSettings->threads; ++i) {
         searchThreads[i]->set_root_node(rootNode);
         searchThreads[i]->set_root_pos(rootPos);
         searchThreads[i]->set_search_limits(searchLimits);
-        threads[i] = new thread(run_search_thread, searchThreads[i]);
+        // the search threads are distributed evenly over the NUMA nodes if a thread affinity is set
+        searchThreads[i]->set_numa_node(i % get_number_numa_nodes());
+        SearchThread* searchThread = searchThreads[i];
+        chrono::steady_clock::time_point* startTime = &startTimes[i];
+        searchJobs.emplace_back(threadPool->submit([searchThread, startTime]() {
+            *startTime = chrono::steady_clock::now();
+            run_search_thread(searchThread);
+            merge_local_lock_counters();
+        merge_local_memory_counters();
+        }));
     }
-    loggerThread = make_unique<LoggerThread>(rootNode, evalInfo, 1000, searchThreads);
-    int curMovetime = timeManager->get_time_for_move(searchLimits, rootPos->side_to_move(), rootNode->plies_from_null()/2);
-    threadManager = make_unique<ThreadManager>(rootNode, searchThreads, loggerThread.get(), curMovetime, 200, overallNPS, lastValueEval);
-    unique_ptr<thread> tManager = make_unique<thread>(run_thread_manager, threadManager.get());
-    unique_ptr<thread> tLogger = make_unique<thread>(run_logger_thread, loggerThread.get());
+    loggerThread = make_unique<LoggerThread>(rootNode, evalInfo, 1000, searchThreads, searchSettings->logSearchStatistics);
+    threadManager = make_unique<ThreadManager>(rootNode, searchThreads, loggerThread.get(), &searchBudget, curMovetime, 200, overallNPS, lastValueEval);
+    ThreadManager* curThreadManager = threadManager.get();
+    LoggerThread* curLoggerThread = loggerThread.get();
+    const ThreadAffinity threadAffinity = searchSettings->threadAffinity;
+    // the manager and logger run on the search CPUs, so they don't compete with the inference runtime
+    const vector<int> searchCpus = searchSettings->searchCpus;
+    future<void> managerJob = threadPool->submit([curThreadManager, threadAffinity, searchCpus]() {
+        if (searchCpus.empty()) {
+            set_thread_affinity(threadAffinity, 0);
+        }
+        else {
+            pin_thread_to_cpus(searchCpus);
+        }
+        run_thread_manager(curThreadManager);
+        merge_local_lock_counters();
+        merge_local_memory_counters();
+    });
+    future<void> loggerJob = threadPool->submit([curLoggerThread, threadAffinity, searchCpus]() {
+        if (searchCpus.empty()) {
+            set_thread_affinity(threadAffinity, 0);
+        }
+        else {
+            pin_thread_to_cpus(searchCpus);
+        }
+        run_logger_thread(curLoggerThread);
+        merge_local_lock_counters();
+        merge_local_memory_counters();
+    });
     isRunning = true;
 
-    for (size_t i = 0; i < searchSettings->threads; ++i) {
-        threads[i]->join();
+    for (future<void>& searchJob : searchJobs) {
+        searchJob.get();
     }
     loggerThread->kill();
     threadManager->kill();
-    tLogger->join();
-    tManager->join();
-    delete[] threads;
+    loggerJob.get();
+    managerJob.get();
+    startupLatencyUS = chrono::duration_cast<chrono::microseconds>(*max_element(startTimes.begin(), startTimes.end()) - dispatchTime).count();
+#ifdef LOCK_PROFILING
+    // the thread local counters have been merged at the end of every job
+    cout << lockStatistics << endl;
+#endif
+    tracer.write_search_trace();
+    // the memory changes of the search jobs have been merged at the end of every job
+    merge_local_memory_counters();
+    info_string(memoryStatistics);
     isRunning = false;
 }
 
@@ -342,3 +448,12 @@ void MCTSAgent::print_root_node()
     }
     print_node_statistics(rootNode);
 }
+
+void MCTSAgent::print_search_statistics()
+{
+    if (rootNode == nullptr) {
+        info_string("You must do a search before you can print the search statistics");
+        return;
+    }
+    ::print_search_statistics(rootNode, searchThreads);
+}
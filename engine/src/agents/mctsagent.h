@@ -46,6 +46,7 @@
 #include "../manager/statesmanager.h"
 #include "../manager/timemanager.h"
 #include "../manager/threadmanager.h"
+#include "../util/threadpool.h"
 
 class MCTSAgent : public Agent
 {
@@ -89,6 +90,14 @@ private:
 
     unique_ptr<ThreadManager> threadManager;
     unique_ptr<LoggerThread> loggerThread;
+    // playouts and deadline of the current search which are shared by all search threads
+    SearchBudget searchBudget;
+
+    // long-lived workers which run the search threads, the thread manager and the logger of every search
+    // (declared last, so the idle workers are joined before the other members are destroyed)
+    unique_ptr<ThreadPool> threadPool;
+    // time from dispatching the search until the last search thread has started its work
+    size_t startupLatencyUS;
 
 public:
     MCTSAgent(NeuralNetAPI* netSingle,
@@ -117,6 +126,30 @@ public:
      */
     void print_root_node();
 
+    /**
+     * @brief print_search_statistics Prints the collision, transposition, terminal and batch fill counters of the last search
+     * as well as the depth histogram, branching factor and number of allocated NodeData objects of the current tree
+     */
+    void print_search_statistics();
+
+    /**
+     * @brief get_startup_latency_us Returns the time in microseconds which was needed to start all search threads of the last search
+     * @return size_t
+     */
+    size_t get_startup_latency_us() const;
+
+    /**
+     * @brief get_search_counters Returns the accumulated collision, transposition, terminal and batch counters of the last search
+     * @return SearchCounters
+     */
+    SearchCounters get_search_counters() const;
+
+    /**
+     * @brief get_perf_values Returns the hardware performance counter values of the last search for each search thread
+     * @return vector of PerfValues
+     */
+    vector<PerfValues> get_perf_values() const;
+
     /**
      * @brief apply_move_to_tree Applies the given move to the search tree by adding the expanded node to the candidate list
      * @param move Move which has been played
@@ -194,6 +227,11 @@ private:
      */
     void delete_old_tree();
 
+    /**
+     * @brief compact_root_tree Copies the reused tree into new memory in breadth-first order (see compact_tree())
+     */
+    void compact_root_tree();
+
     /**
      * @brief sleep_and_log_for Sleeps for a given amout of ms while every update interval ms the eval info will be updated an printed to stdout
      * @param evalInfo Evaluation information
@@ -24,15 +24,20 @@
  */
 
 #include "loggerthread.h"
+#include "searchstatistics.h"
+#include "../../util/tracer.h"
+#include "../../util/memorystatistics.h"
 #include <thread>
 #include <chrono>
 
-LoggerThread::LoggerThread(Node* rootNode, EvalInfo* evalInfo, size_t updateIntervalMS, vector<SearchThread*>& searchThreads):
+LoggerThread::LoggerThread(Node* rootNode, EvalInfo* evalInfo, size_t updateIntervalMS, vector<SearchThread*>& searchThreads, bool logStatistics):
     KillableThread(),
     rootNode(rootNode),
     searchThreads(searchThreads),
     evalInfo(evalInfo),
-    updateIntervalMS(updateIntervalMS)
+    updateIntervalMS(updateIntervalMS),
+    logStatistics(logStatistics),
+    memoryWarningIssued(false)
 {
 
 }
@@ -41,15 +46,24 @@ void LoggerThread::wait_and_log()
 {
     while(isRunning) {
         if (wait_for(chrono::milliseconds(updateIntervalMS))){
+            TraceSpan span("log");
             evalInfo->end = chrono::steady_clock::now();
             update_eval_info(*evalInfo, rootNode, get_tb_hits(searchThreads));
             info_score(*evalInfo);
+            if (logStatistics) {
+                print_search_statistics(rootNode, searchThreads);
+            }
+            if (!memoryWarningIssued && memoryStatistics.is_memory_critical(0.9f)) {
+                info_string("Warning: the search tree uses more than 90% of the physical memory:", memoryStatistics);
+                memoryWarningIssued = true;
+            }
         }
     }
 }
 
 void run_logger_thread(LoggerThread *t)
 {
+    tracer.set_thread_name("logger thread");
     t->wait_and_log();
 }
 
@@ -48,13 +48,17 @@ private:
 
     EvalInfo* evalInfo;
     size_t updateIntervalMS;
+    // if true, the search counters and tree statistics are printed at every log interval
+    bool logStatistics;
+    // the memory warning is only printed once per search
+    bool memoryWarningIssued;
 public:
     /**
      * @brief wait_and_log Logs indefinetly with a certain logging interval until the conditional variable is triggered
      */
     void wait_and_log();
 
-    LoggerThread(Node* rootNode, EvalInfo* evalInfo, size_t updateIntervalMS, vector<SearchThread*>& searchThreads);
+    LoggerThread(Node* rootNode, EvalInfo* evalInfo, size_t updateIntervalMS, vector<SearchThread*>& searchThreads, bool logStatistics = false);
 };
 
 /**
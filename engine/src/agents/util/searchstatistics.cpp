@@ -0,0 +1,120 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: searchstatistics.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "searchstatistics.h"
+#include <iomanip>
+
+TreeStatistics::TreeStatistics():
+    numberNodes(0),
+    numberNodeData(0),
+    numberExpandedChildren(0),
+    numberExpandedParents(0)
+{
+}
+
+float TreeStatistics::mean_branching_factor() const
+{
+    if (numberExpandedParents == 0) {
+        return 0;
+    }
+    return float(numberExpandedChildren) / numberExpandedParents;
+}
+
+void fill_tree_statistics(Node* node, size_t depth, TreeStatistics& stats)
+{
+    if (node == nullptr) {
+        return;
+    }
+    if (stats.depthHistogram.size() <= depth) {
+        stats.depthHistogram.resize(depth+1, 0);
+    }
+    ++stats.depthHistogram[depth];
+    ++stats.numberNodes;
+
+    node->lock();
+    if (!node->is_playout_node()) {
+        node->unlock();
+        return;
+    }
+    ++stats.numberNodeData;
+    const bool isTerminal = node->is_terminal();
+    const vector<Node*> childNodes = node->get_child_nodes();
+    node->unlock();
+
+    if (isTerminal) {
+        return;
+    }
+    size_t expandedChildren = 0;
+    for (Node* childNode : childNodes) {
+        if (childNode != nullptr) {
+            ++expandedChildren;
+            fill_tree_statistics(childNode, depth+1, stats);
+        }
+    }
+    stats.numberExpandedChildren += expandedChildren;
+    ++stats.numberExpandedParents;
+}
+
+SearchCounters get_search_counters(const vector<SearchThread*>& searchThreads)
+{
+    SearchCounters counters;
+    for (SearchThread* searchThread : searchThreads) {
+        counters += searchThread->get_search_counters();
+    }
+    return counters;
+}
+
+void print_search_statistics(Node* rootNode, const vector<SearchThread*>& searchThreads)
+{
+    TreeStatistics treeStats;
+    fill_tree_statistics(rootNode, 0, treeStats);
+    cout << get_search_counters(searchThreads) << endl
+         << treeStats << endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const SearchCounters& counters)
+{
+    os << std::fixed << std::setprecision(2)
+       << "info string collisions " << counters.collisions
+       << " transpositions " << counters.transpositions
+       << " terminalhits " << counters.terminalHits
+       << " batches " << counters.nnBatches
+       << " batchfill " << (counters.nnBatchSlots == 0 ? 0.0f : 100.0f * counters.nnSamples / counters.nnBatchSlots) << "%";
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const TreeStatistics& stats)
+{
+    os << std::fixed << std::setprecision(2)
+       << "info string treenodes " << stats.numberNodes
+       << " nodedata " << stats.numberNodeData
+       << " branching " << stats.mean_branching_factor() << endl
+       << "info string depth histogram";
+    for (size_t depth = 0; depth < stats.depthHistogram.size(); ++depth) {
+        os << ' ' << depth << ':' << stats.depthHistogram[depth];
+    }
+    return os;
+}
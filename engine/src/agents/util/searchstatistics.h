@@ -0,0 +1,90 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: searchstatistics.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Additional search statistics beyond the EvalInfo (collisions, transpositions, terminal hits, batch fill)
+ * and the shape of the current search tree (depth histogram, branching factor, allocated NodeData).
+ */
+
+#ifndef SEARCHSTATISTICS_H
+#define SEARCHSTATISTICS_H
+
+#include <vector>
+#include <iostream>
+#include "../../node.h"
+#include "../../searchthread.h"
+
+using namespace std;
+
+/**
+ * @brief The TreeStatistics struct summarizes the shape of the search tree
+ */
+struct TreeStatistics
+{
+    // number of nodes for each depth starting with the root node at depth 0
+    vector<size_t> depthHistogram;
+    size_t numberNodes;
+    // nodes which have a NodeData object allocated
+    size_t numberNodeData;
+    // number of expanded child nodes over all nodes which have a NodeData object and aren't terminal
+    size_t numberExpandedChildren;
+    size_t numberExpandedParents;
+
+    TreeStatistics();
+
+    /**
+     * @brief mean_branching_factor Returns the average number of expanded child nodes of all non-terminal nodes with NodeData
+     * @return float
+     */
+    float mean_branching_factor() const;
+
+    friend std::ostream& operator<<(std::ostream& os, const TreeStatistics& stats);
+};
+
+/**
+ * @brief fill_tree_statistics Traverses the subtree of the given node and updates the tree statistics.
+ * Every node is locked while its child nodes are accessed, so this function can be called during search.
+ * @param node Node to start from
+ * @param depth Depth of the given node
+ * @param stats Statistics which will be updated
+ */
+void fill_tree_statistics(Node* node, size_t depth, TreeStatistics& stats);
+
+/**
+ * @brief get_search_counters Returns the accumulated counters of all search threads
+ * @param searchThreads MCTS search threads
+ * @return SearchCounters
+ */
+SearchCounters get_search_counters(const vector<SearchThread*>& searchThreads);
+
+/**
+ * @brief print_search_statistics Prints the search counters and tree statistics to stdout in accordance with the UCI-protocol (info string ...)
+ * @param rootNode Root node of the search tree
+ * @param searchThreads MCTS search threads
+ */
+void print_search_statistics(Node* rootNode, const vector<SearchThread*>& searchThreads);
+
+std::ostream& operator<<(std::ostream& os, const SearchCounters& counters);
+
+#endif // SEARCHSTATISTICS_H
@@ -42,6 +42,10 @@
 #include "optionsuci.h"
 #include "tests/benchmarkpositions.h"
 #include "util/communication.h"
+#include "util/memorystatistics.h"
+#include "nn/sharedbatchapi.h"
+#include <thread>
+#include <cstdlib>
 #ifdef MXNET
 #include "nn/mxnetapi.h"
 #elif defined TENSORRT
@@ -149,11 +153,13 @@ void CrazyAra::uci_loop(int argc, char *argv[])
         // Additional custom non-UCI commands, mainly for debugging
         else if (token == "benchmark")  benchmark(is);
         else if (token == "root")       mctsAgent->print_root_node();
+        else if (token == "stats")      mctsAgent->print_search_statistics();
         else if (token == "flip")       pos.flip();
         else if (token == "d")          cout << pos << endl;
 #ifdef USE_RL
         else if (token == "selfplay")   selfplay(is);
         else if (token == "arena")      arena(is);
+        else if (token == "exportbenchmark") export_benchmark(is);
 #endif
         else
             cout << "Unknown command: " << cmd << endl;
@@ -216,6 +222,8 @@ void CrazyAra::go(const string& fen, string goCommand, EvalInfo& evalInfo)
     position(&pos, is);
     istringstream isGoCommand(goCommand);
     go(&pos, isGoCommand, evalInfo);
+    // the search uses the local board position
+    wait_to_finish_last_search();
 }
 
 void CrazyAra::wait_to_finish_last_search()
@@ -277,7 +285,29 @@ void CrazyAra::benchmark(istringstream &is)
     string goCommand = "go movetime " + moveTime;
     int totalNPS = 0;
     int totalDepth = 0;
+    size_t totalStartupLatencyUS = 0;
     vector<int> nps;
+    // "benchmark <movetime> perf" additionally collects hardware performance counters
+    string token;
+    is >> token;
+    if (token == "numa") {
+        benchmark_thread_affinity(goCommand);
+        return;
+    }
+    if (token == "truncation") {
+        benchmark_policy_truncation(goCommand);
+        return;
+    }
+    if (token == "compact") {
+        benchmark_tree_compaction(goCommand);
+        return;
+    }
+    if (token == "leaves") {
+        benchmark_leaf_compaction(goCommand);
+        return;
+    }
+    searchSettings.usePerfCounters = token == "perf";
+    vector<PerfValues> perfValues(searchSettings.threads);
 
     for (TestPosition pos : benchmark.positions) {
         go(pos.fen, goCommand, evalInfo);
@@ -300,6 +330,13 @@ void CrazyAra::benchmark(istringstream &is)
         totalNPS += cur_nps;
         totalDepth += evalInfo.depth;
         nps.push_back(cur_nps);
+        totalStartupLatencyUS += mctsAgent->get_startup_latency_us();
+        if (searchSettings.usePerfCounters) {
+            const vector<PerfValues> curPerfValues = mctsAgent->get_perf_values();
+            for (size_t threadIdx = 0; threadIdx < curPerfValues.size(); ++threadIdx) {
+                perfValues[threadIdx] += curPerfValues[threadIdx];
+            }
+        }
     }
 
     sort(nps.begin(), nps.end());
@@ -310,35 +347,393 @@ void CrazyAra::benchmark(istringstream &is)
     cout << "NPS (avg):\t" << setw(2) << totalNPS /  benchmark.positions.size() << endl;
     cout << "NPS (median):\t" << setw(2) << nps[nps.size()/2] << endl;
     cout << "PV-Depth:\t" << setw(2) << totalDepth /  benchmark.positions.size() << endl;
+    cout << "Startup (avg):\t" << setw(2) << totalStartupLatencyUS / benchmark.positions.size() << " us" << endl;
+    if (huge_pages_enabled()) {
+        print_huge_page_statistics(cout);
+        cout << endl;
+    }
+    if (searchSettings.usePerfCounters) {
+        print_perf_report(perfValues);
+        searchSettings.usePerfCounters = false;
+    }
+}
+
+void CrazyAra::benchmark_thread_affinity(const string& goCommand)
+{
+    EvalInfo evalInfo;
+    BenchmarkPositions benchmark;
+    const ThreadAffinity userAffinity = searchSettings.threadAffinity;
+
+    cout << "NUMA nodes:\t" << get_number_numa_nodes() << endl;
+    for (ThreadAffinity affinity : {AFFINITY_NONE, AFFINITY_NUMA_LOCAL, AFFINITY_NUMA_REMOTE}) {
+        searchSettings.threadAffinity = affinity;
+        int totalNPS = 0;
+        for (TestPosition pos : benchmark.positions) {
+            go(pos.fen, goCommand, evalInfo);
+            totalNPS += evalInfo.calculate_nps();
+        }
+        cout << "NPS (avg):\t" << setw(2) << totalNPS / benchmark.positions.size()
+             << " (" << thread_affinity_to_string(affinity) << ")" << endl;
+    }
+    searchSettings.threadAffinity = userAffinity;
+}
+
+void CrazyAra::benchmark_policy_truncation(const string& goCommand)
+{
+    EvalInfo evalInfo;
+    BenchmarkPositions benchmark;
+    const float userThreshold = searchSettings.policyMassThreshold;
+    vector<string> fullPolicyMoves;
+    size_t sameMoveCounter = 0;
+
+    for (float threshold : {1.0f, userThreshold < 1.0f ? userThreshold : 0.995f}) {
+        searchSettings.policyMassThreshold = threshold;
+        int passedCounter = 0;
+        int totalNPS = 0;
+        size_t totalBytesPerNode = 0;
+        for (size_t idx = 0; idx < benchmark.positions.size(); ++idx) {
+            const TestPosition& pos = benchmark.positions[idx];
+            go(pos.fen, goCommand, evalInfo);
+            const string uciMove = UCI::move(evalInfo.bestMove, false);
+            if (uciMove != pos.blunderMove) {
+                passedCounter++;
+            }
+            if (threshold == 1.0f) {
+                fullPolicyMoves.push_back(uciMove);
+            }
+            else if (uciMove == fullPolicyMoves[idx]) {
+                sameMoveCounter++;
+            }
+            totalNPS += evalInfo.calculate_nps();
+            // the tree of the search is still allocated
+            merge_local_memory_counters();
+            totalBytesPerNode += memoryStatistics.get_total_bytes() / max(memoryStatistics.get_number_nodes(), int64_t(1));
+        }
+        cout << "Passed:\t\t" << passedCounter << "/" << benchmark.positions.size()
+             << " NPS (avg): " << totalNPS / benchmark.positions.size()
+             << " bytes per node (avg): " << totalBytesPerNode / benchmark.positions.size()
+             << " (policy mass " << threshold << ")" << endl;
+    }
+    cout << "Same move:\t" << sameMoveCounter << "/" << benchmark.positions.size() << endl;
+    searchSettings.policyMassThreshold = userThreshold;
+}
+
+void CrazyAra::benchmark_tree_compaction(const string& goCommand)
+{
+    EvalInfo evalInfo;
+    BenchmarkPositions benchmark;
+    const bool userCompactTree = searchSettings.compactTree;
+
+    for (bool compactTree : {false, true}) {
+        searchSettings.compactTree = compactTree;
+        int totalNPS = 0;
+        size_t reusedSearches = 0;
+        for (const TestPosition& pos : benchmark.positions) {
+            mctsAgent->clear_game_history();
+            go(pos.fen, goCommand, evalInfo);
+            if (evalInfo.pv.size() < 2) {
+                continue;
+            }
+            // the expected reply is played, so the second search continues on the subtree of the principal variation
+            const string moves = UCI::move(evalInfo.pv[0], false) + " " + UCI::move(evalInfo.pv[1], false);
+            go(pos.fen + " moves " + moves, goCommand, evalInfo);
+            if (evalInfo.nodesPreSearch != 0) {
+                totalNPS += evalInfo.calculate_nps();
+                ++reusedSearches;
+            }
+        }
+        cout << "NPS (avg):\t" << setw(2) << (reusedSearches == 0 ? 0 : totalNPS / int(reusedSearches))
+             << " (Compact_Tree " << (compactTree ? "true" : "false") << ", " << reusedSearches << " searches on a reused tree)" << endl;
+    }
+    mctsAgent->clear_game_history();
+    searchSettings.compactTree = userCompactTree;
+}
+
+void CrazyAra::benchmark_leaf_compaction(const string& goCommand)
+{
+    EvalInfo evalInfo;
+    BenchmarkPositions benchmark;
+    const bool userCompactLeafNodes = searchSettings.compactLeafNodes;
+    vector<string> fullLeafMoves;
+    size_t sameMoveCounter = 0;
+
+    for (bool compactLeafNodes : {false, true}) {
+        searchSettings.compactLeafNodes = compactLeafNodes;
+        int passedCounter = 0;
+        int totalNPS = 0;
+        size_t totalBytesPerNode = 0;
+        size_t totalPolicyBytesPerNode = 0;
+        for (size_t idx = 0; idx < benchmark.positions.size(); ++idx) {
+            const TestPosition& pos = benchmark.positions[idx];
+            go(pos.fen, goCommand, evalInfo);
+            const string uciMove = UCI::move(evalInfo.bestMove, false);
+            if (uciMove != pos.blunderMove) {
+                passedCounter++;
+            }
+            if (!compactLeafNodes) {
+                fullLeafMoves.push_back(uciMove);
+            }
+            else if (uciMove == fullLeafMoves[idx]) {
+                sameMoveCounter++;
+            }
+            totalNPS += evalInfo.calculate_nps();
+            // the tree of the search is still allocated
+            merge_local_memory_counters();
+            const int64_t numberNodes = max(memoryStatistics.get_number_nodes(), int64_t(1));
+            totalBytesPerNode += memoryStatistics.get_total_bytes() / numberNodes;
+            totalPolicyBytesPerNode += (memoryStatistics.get_bytes(MEM_LEGAL_MOVES) + memoryStatistics.get_bytes(MEM_POLICY)) / numberNodes;
+        }
+        cout << "Passed:\t\t" << passedCounter << "/" << benchmark.positions.size()
+             << " NPS (avg): " << totalNPS / benchmark.positions.size()
+             << " bytes per node (avg): " << totalBytesPerNode / benchmark.positions.size()
+             << " moves and policy bytes per node (avg): " << totalPolicyBytesPerNode / benchmark.positions.size()
+             << " (Compact_Leaf_Nodes " << (compactLeafNodes ? "true" : "false") << ")" << endl;
+    }
+    cout << "Same move:\t" << sameMoveCounter << "/" << benchmark.positions.size() << endl;
+    searchSettings.compactLeafNodes = userCompactLeafNodes;
 }
 
 #ifdef USE_RL
 void CrazyAra::selfplay(istringstream &is)
 {
-    SearchLimits searchLimits;
-    searchLimits.nodes = size_t(Options["Nodes"]);
-    SelfPlay selfPlay(rawAgent.get(), mctsAgent.get(), &searchLimits, &playSettings, &rlSettings);
     size_t numberOfGames;
     is >> numberOfGames;
-    selfPlay.go(numberOfGames, &states, variant);
+    if (rlSettings.concurrentGames > 1) {
+        selfplay_concurrent(numberOfGames);
+    }
+    else {
+        SearchLimits searchLimits;
+        searchLimits.nodes = size_t(Options["Nodes"]);
+        SelfPlay selfPlay(rawAgent.get(), mctsAgent.get(), &searchLimits, &playSettings, &rlSettings);
+        if (rlSettings.openingPoolSize != 0) {
+            selfPlay.enable_opening_pool(netBatches.front().get());
+        }
+        selfPlay.go(numberOfGames, &states, variant);
+    }
     cout << "readyok" << endl;
 }
 
+namespace {
+// MCTSAgent whose networks forward all requests to a shared batch
+struct SharedBatchAgent
+{
+    unique_ptr<NeuralNetAPI> netSingle;
+    vector<unique_ptr<NeuralNetAPI>> netBatches;
+    // every agent needs its own settings because they are modified for quick searches
+    SearchSettings searchSettings;
+    unique_ptr<MCTSAgent> mctsAgent;
+
+    SharedBatchAgent(SharedBatch* sharedBatch, int deviceId, const string& modelDirectory, const SearchSettings& settings,
+                     size_t threads, PlaySettings* playSettings, StatesManager* states):
+        searchSettings(settings)
+    {
+        const string context = Options["Context"];
+        netSingle = make_unique<SharedBatchClientAPI>(sharedBatch, context, deviceId, 1, modelDirectory);
+        for (size_t threadIdx = 0; threadIdx < threads; ++threadIdx) {
+            netBatches.emplace_back(make_unique<SharedBatchClientAPI>(sharedBatch, context, deviceId, settings.batchSize, modelDirectory));
+        }
+        searchSettings.threads = threads;
+        mctsAgent = make_unique<MCTSAgent>(netSingle.get(), netBatches, &searchSettings, playSettings, states);
+    }
+};
+
+// all objects which belong to a single concurrently generated self play or arena game
+struct SelfPlayWorker
+{
+    SearchLimits searchLimits;
+    StatesManager states;
+    unique_ptr<SharedBatchAgent> agent;
+    // only used for arena games
+    unique_ptr<SharedBatchAgent> contender;
+    unique_ptr<RawNetAgent> rawAgent;
+    unique_ptr<SelfPlay> selfPlay;
+};
+
+void print_shared_batch_fill(const vector<unique_ptr<NeuralNetAPI>>& sharedNets, const vector<unique_ptr<SharedBatch>>& sharedBatches)
+{
+    for (size_t deviceIdx = 0; deviceIdx < sharedBatches.size(); ++deviceIdx) {
+        cout << "Shared batch fill (" << sharedNets[deviceIdx]->get_model_name() << ", " << sharedNets[deviceIdx]->get_device_name() << "): "
+             << 100.0f * sharedBatches[deviceIdx]->get_average_fill() << "%" << endl;
+    }
+}
+}
+
+void CrazyAra::selfplay_concurrent(size_t numberOfGames)
+{
+    const string modelDirectory = Options["Model_Directory"];
+    const size_t threadsPerGame = Options["Threads"];
+    const size_t numberDevices = get_num_gpus(Options);
+    const size_t gamesPerDevice = (rlSettings.concurrentGames + numberDevices - 1) / numberDevices;
+
+    vector<unique_ptr<NeuralNetAPI>> sharedNets;
+    vector<unique_ptr<SharedBatch>> sharedBatches;
+    create_shared_batches(modelDirectory, gamesPerDevice * threadsPerGame * searchSettings.batchSize, sharedNets, sharedBatches);
+    SharedSelfPlayState sharedState(mctsAgent->get_device_name(), rlSettings);
+
+    vector<unique_ptr<SelfPlayWorker>> workers;
+    for (size_t gameIdx = 0; gameIdx < rlSettings.concurrentGames; ++gameIdx) {
+        const size_t deviceIdx = gameIdx % numberDevices;
+        const int deviceId = int(Options["First_Device_ID"]) + int(deviceIdx);
+        unique_ptr<SelfPlayWorker> worker = make_unique<SelfPlayWorker>();
+        worker->agent = make_unique<SharedBatchAgent>(sharedBatches[deviceIdx].get(), deviceId, modelDirectory, searchSettings,
+                                                      threadsPerGame, &playSettings, &worker->states);
+        worker->searchLimits.nodes = size_t(Options["Nodes"]);
+        worker->rawAgent = make_unique<RawNetAgent>(worker->agent->netSingle.get(), &playSettings, false);
+        worker->selfPlay = make_unique<SelfPlay>(worker->rawAgent.get(), worker->agent->mctsAgent.get(), &worker->searchLimits,
+                                                 &playSettings, &rlSettings, &sharedState);
+        if (rlSettings.openingPoolSize != 0) {
+            worker->selfPlay->enable_opening_pool(worker->agent->netBatches.front().get());
+        }
+        workers.emplace_back(move(worker));
+    }
+
+    // the search threads register themselves at the shared batch while they are running
+    vector<thread> workerThreads;
+    for (unique_ptr<SelfPlayWorker>& worker : workers) {
+        SelfPlayWorker* curWorker = worker.get();
+        workerThreads.emplace_back([this, curWorker, numberOfGames]() {
+            curWorker->selfPlay->go_concurrent(numberOfGames, &curWorker->states, variant);
+        });
+    }
+    for (thread& workerThread : workerThreads) {
+        workerThread.join();
+    }
+    workers.front()->selfPlay->export_number_generated_games();
+    print_shared_batch_fill(sharedNets, sharedBatches);
+}
+
+TournamentResult CrazyAra::arena_concurrent(size_t numberOfGames)
+{
+    const string modelDirectory = Options["Model_Directory"];
+    const string modelDirectoryContender = Options["Model_Directory_Contender"];
+    const size_t threadsPerGame = Options["Threads"];
+    const size_t numberDevices = get_num_gpus(Options);
+    const size_t gamesPerDevice = (rlSettings.concurrentGames + numberDevices - 1) / numberDevices;
+    const size_t sharedBatchSize = gamesPerDevice * threadsPerGame * searchSettings.batchSize;
+
+    // both networks get their own shared batches which are filled by the games in which the respective player is to move
+    vector<unique_ptr<NeuralNetAPI>> sharedNets;
+    vector<unique_ptr<SharedBatch>> sharedBatches;
+    vector<unique_ptr<NeuralNetAPI>> sharedNetsContender;
+    vector<unique_ptr<SharedBatch>> sharedBatchesContender;
+    create_shared_batches(modelDirectory, sharedBatchSize, sharedNets, sharedBatches);
+    create_shared_batches(modelDirectoryContender, sharedBatchSize, sharedNetsContender, sharedBatchesContender);
+    SharedArenaState arenaState;
+    arenaState.tournamentResult.playerA = sharedNetsContender.front()->get_model_name();
+    arenaState.tournamentResult.playerB = sharedNets.front()->get_model_name();
+
+    vector<unique_ptr<SelfPlayWorker>> workers;
+    for (size_t gameIdx = 0; gameIdx < rlSettings.concurrentGames; ++gameIdx) {
+        const size_t deviceIdx = gameIdx % numberDevices;
+        const int deviceId = int(Options["First_Device_ID"]) + int(deviceIdx);
+        unique_ptr<SelfPlayWorker> worker = make_unique<SelfPlayWorker>();
+        worker->agent = make_unique<SharedBatchAgent>(sharedBatches[deviceIdx].get(), deviceId, modelDirectory, searchSettings,
+                                                      threadsPerGame, &playSettings, &worker->states);
+        worker->contender = make_unique<SharedBatchAgent>(sharedBatchesContender[deviceIdx].get(), deviceId, modelDirectoryContender,
+                                                          searchSettings, threadsPerGame, &playSettings, &worker->states);
+        worker->searchLimits.nodes = size_t(Options["Nodes"]);
+        worker->rawAgent = make_unique<RawNetAgent>(worker->agent->netSingle.get(), &playSettings, false);
+        worker->selfPlay = make_unique<SelfPlay>(worker->rawAgent.get(), worker->agent->mctsAgent.get(), &worker->searchLimits,
+                                                 &playSettings, &rlSettings);
+        workers.emplace_back(move(worker));
+    }
+
+    vector<thread> workerThreads;
+    for (unique_ptr<SelfPlayWorker>& worker : workers) {
+        SelfPlayWorker* curWorker = worker.get();
+        workerThreads.emplace_back([this, curWorker, numberOfGames, &arenaState]() {
+            curWorker->selfPlay->go_arena_concurrent(curWorker->contender->mctsAgent.get(), numberOfGames, &curWorker->states, variant, &arenaState);
+        });
+    }
+    for (thread& workerThread : workerThreads) {
+        workerThread.join();
+    }
+    print_shared_batch_fill(sharedNets, sharedBatches);
+    print_shared_batch_fill(sharedNetsContender, sharedBatchesContender);
+    return arenaState.tournamentResult;
+}
+
+void CrazyAra::export_benchmark(istringstream &is)
+{
+    size_t numberOfGames = 1000;
+    is >> numberOfGames;
+    // "exportbenchmark <games> compact" uses the compact sample format
+    string token;
+    const bool compactExport = (is >> token) && token == "compact";
+    const size_t minGameLength = 20;
+    const size_t maxGameLength = 400;
+
+    // the samples are all derived from the starting position, only the game lengths differ
+    StateInfo* newState = new StateInfo;
+    Board pos;
+    pos.set(StartFENs[variant], false, variant, newState, uiThread.get());
+    EvalInfo evalInfo;
+    for (const ExtMove& move : MoveList<LEGAL>(pos)) {
+        evalInfo.legalMoves.push_back(move);
+    }
+    evalInfo.policyProbSmall = DynamicVector<float>(evalInfo.legalMoves.size(), 1.0f / evalInfo.legalMoves.size());
+    evalInfo.bestMoveQ = 0.1f;
+    float inputPlanes[NB_VALUES_TOTAL];
+    board_to_planes(&pos, 0, false, inputPlanes);
+
+    srand(42);
+    vector<size_t> gameLengths(numberOfGames);
+    size_t totalSamples = 0;
+    for (size_t& gameLength : gameLengths) {
+        gameLength = minGameLength + size_t(rand()) % (maxGameLength - minGameLength + 1);
+        totalSamples += gameLength;
+    }
+    const size_t numberChunks = (totalSamples + rlSettings.chunkSize - 1) / rlSettings.chunkSize;
+    TrainDataExporter exporter("export_benchmark.zarr", numberChunks, rlSettings.chunkSize, compactExport);
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t gameIdx = 0; gameIdx < numberOfGames; ++gameIdx) {
+        exporter.new_game();
+        for (size_t ply = 0; ply < gameLengths[gameIdx]; ++ply) {
+            exporter.save_sample(inputPlanes, evalInfo, Color(ply % 2));
+        }
+        exporter.export_game_samples(Result(gameIdx % 3));
+    }
+    // include the time of the writer thread
+    exporter.close();
+    const float elapsedS = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1e6f;
+    delete newState;
+
+    cout << endl << "Summary" << endl;
+    cout << "----------------------" << endl;
+    cout << "Games:		" << numberOfGames << endl;
+    cout << "Samples:	" << totalSamples << endl;
+    cout << "Time (s):	" << elapsedS << endl;
+    cout << "Games/s:	" << numberOfGames / elapsedS << endl;
+    cout << "Samples/s:	" << totalSamples / elapsedS << endl;
+}
+
 void CrazyAra::arena(istringstream &is)
 {
     SearchLimits searchLimits;
     searchLimits.nodes = size_t(Options["Nodes"]);
     SelfPlay selfPlay(rawAgent.get(), mctsAgent.get(), &searchLimits, &playSettings, &rlSettings);
-    netSingle = create_new_net_single(Options["Model_Directory_Contender"]);
-    netBatches = create_new_net_batches(Options["Model_Directory_Contender"]);
-    mctsAgentContender = create_new_mcts_agent(netSingle.get(), netBatches, &states);
     size_t numberOfGames;
     is >> numberOfGames;
-    TournamentResult tournamentResult = selfPlay.go_arena(mctsAgentContender.get(), numberOfGames, &states, variant);
+    TournamentResult tournamentResult;
+    if (rlSettings.concurrentGames > 1) {
+        tournamentResult = arena_concurrent(numberOfGames);
+    }
+    else {
+        netSingle = create_new_net_single(Options["Model_Directory_Contender"]);
+        netBatches = create_new_net_batches(Options["Model_Directory_Contender"]);
+        mctsAgentContender = create_new_mcts_agent(netSingle.get(), netBatches, &states);
+        tournamentResult = selfPlay.go_arena(mctsAgentContender.get(), numberOfGames, &states, variant);
+    }
 
     cout << "Arena summary" << endl;
     cout << "Score of Contender vs Producer: " << tournamentResult << endl;
-    if (tournamentResult.score() > 0.5f) {
+    const SPRTResult sprtResult = rlSettings.arenaSPRT ? sprt_decision(tournamentResult, rlSettings.sprtElo0, rlSettings.sprtElo1,
+                                                                        rlSettings.sprtAlpha, rlSettings.sprtBeta) : SPRT_CONTINUE;
+    if (sprtResult != SPRT_CONTINUE) {
+        cout << "SPRT: " << (sprtResult == SPRT_ACCEPT_H1 ? "H1" : "H0") << " accepted" << endl;
+    }
+    if (sprtResult == SPRT_ACCEPT_H1 || (sprtResult == SPRT_CONTINUE && tournamentResult.score() > 0.5f)) {
         cout << "replace" << endl;
     }
     else {
@@ -361,6 +756,22 @@ void CrazyAra::init_rl_settings()
     rlSettings.resignProbability = Options["Centi_Resign_Probability"] / 100.0f;
     rlSettings.resignThreshold = Options["Centi_Resign_Threshold"] / 100.0f;
     rlSettings.reuseTreeForSelpay = Options["Reuse_Tree"];
+    rlSettings.concurrentGames = Options["Selfplay_Concurrent_Games"];
+    rlSettings.sharedBatchTimeoutUS = Options["Selfplay_Batch_Timeout_us"];
+    rlSettings.compactExport = Options["Selfplay_Compact_Export"];
+    rlSettings.multiWriterExport = Options["Selfplay_Multi_Writer"];
+    rlSettings.compressPGN = Options["Selfplay_Compress_PGN"];
+    rlSettings.metricsIntervalS = Options["Selfplay_Metrics_Interval_s"];
+    rlSettings.openingPoolSize = Options["Selfplay_Opening_Pool_Size"];
+    rlSettings.adjudicateTablebase = Options["Selfplay_Adjudicate_Tablebase"];
+    rlSettings.drawAdjudicationThreshold = Options["Centi_Draw_Q_Threshold"] / 100.0f;
+    rlSettings.drawAdjudicationPlies = Options["Draw_Adjudication_Plies"];
+    rlSettings.maxGamePlies = Options["Selfplay_Max_Plies"];
+    rlSettings.arenaSPRT = Options["Arena_SPRT"];
+    rlSettings.sprtElo0 = Options["Arena_SPRT_Elo0"];
+    rlSettings.sprtElo1 = Options["Arena_SPRT_Elo1"];
+    rlSettings.sprtAlpha = Options["Centi_Arena_SPRT_Alpha"] / 100.0f;
+    rlSettings.sprtBeta = Options["Centi_Arena_SPRT_Beta"] / 100.0f;
 }
 #endif
 
@@ -382,16 +793,100 @@ bool CrazyAra::is_ready()
 #ifdef USE_RL
         init_rl_settings();
 #endif
+        // "Search_Cores" splits the CPUs between the search threads and the CPU inference runtime (-1: calibrate the number of search CPUs within an even split)
+        const int searchCores = Options["Search_Cores"];
+        CorePartition partition;
+        if (searchCores != 0 && string(Options["Context"]) == "cpu") {
+            partition = partition_cores(searchCores > 0 ? size_t(searchCores) : get_available_cpus().size() / 2);
+        }
+        if (!partition.inferenceCpus.empty()) {
+            set_inference_threads(partition);
+            // the worker threads of the inference runtime inherit the affinity of the thread which loads the network
+            pin_thread_to_cpus(partition.inferenceCpus);
+        }
         netSingle = create_new_net_single(Options["Model_Directory"]);
         netBatches = create_new_net_batches(Options["Model_Directory"]);
         mctsAgent = create_new_mcts_agent(netSingle.get(), netBatches, &states);
         rawAgent = make_unique<RawNetAgent>(netSingle.get(), &playSettings, false);
         Constants::init(mctsAgent->is_policy_map());
         networkLoaded = true;
+        if (!partition.inferenceCpus.empty()) {
+            apply_core_partition(partition);
+            if (searchCores < 0) {
+                calibrate_core_partition(partition);
+            }
+        }
     }
     return networkLoaded;
 }
 
+void CrazyAra::set_inference_threads(const CorePartition& partition)
+{
+    // every search thread runs its own executor, so the inference CPUs are shared among them
+    const size_t workerThreads = max(size_t(1), min(searchSettings.threads, partition.inferenceCpus.size()));
+    const string intraOpThreads = to_string(max(size_t(1), partition.inferenceCpus.size() / workerThreads));
+    setenv("MXNET_CPU_WORKER_NTHREADS", to_string(workerThreads).c_str(), 1);
+    setenv("OMP_NUM_THREADS", intraOpThreads.c_str(), 1);
+    setenv("MKL_NUM_THREADS", intraOpThreads.c_str(), 1);
+    info_string("inference threads", to_string(workerThreads) + " x " + intraOpThreads);
+}
+
+void CrazyAra::apply_core_partition(const CorePartition& partition)
+{
+    searchSettings.searchCpus = partition.searchCpus;
+    pin_process_threads(partition.inferenceCpus);
+    info_string("core partition search", to_string(partition.searchCpus.size()) + " inference " + to_string(partition.inferenceCpus.size()));
+}
+
+void CrazyAra::calibrate_core_partition(const CorePartition& initialPartition)
+{
+    Board pos;
+    auto calibrationThread = make_shared<Thread>(0);
+    const Variant calibrationVariant = UCI::variant_from_name(Options["UCI_Variant"]);
+    // the StateInfo is deleted by ~Board()
+    pos.set(StartFENs[calibrationVariant], is960, calibrationVariant, new StateInfo, calibrationThread.get());
+
+    // the thread counts of the inference runtime were fixed when the network was loaded,
+    // so only the number of search CPUs is calibrated and the inference CPUs stay unchanged
+    const size_t maxSearchCores = initialPartition.searchCpus.size();
+    CorePartition bestPartition;
+    size_t bestNPS = 0;
+    size_t lastSearchCores = 0;
+    for (size_t searchCores : {maxSearchCores / 4, maxSearchCores / 2, maxSearchCores}) {
+        searchCores = max(size_t(1), searchCores);
+        if (searchCores == lastSearchCores) {
+            continue;
+        }
+        lastSearchCores = searchCores;
+        CorePartition partition;
+        partition.searchCpus.assign(initialPartition.searchCpus.begin(), initialPartition.searchCpus.begin() + searchCores);
+        partition.inferenceCpus = initialPartition.inferenceCpus;
+        apply_core_partition(partition);
+
+        // the search is run directly, so no bestmove is sent during isready
+        SearchLimits calibrationLimits;
+        calibrationLimits.movetime = 500;
+        calibrationLimits.startTime = now();
+        EvalInfo evalInfo;
+        evalInfo.start = chrono::steady_clock::now();
+        mctsAgent->set_search_settings(&pos, &calibrationLimits, &evalInfo);
+        mctsAgent->evaluate_board_state();
+        evalInfo.end = chrono::steady_clock::now();
+        // every partition starts with an empty tree
+        mctsAgent->clear_game_history();
+
+        const size_t nps = evalInfo.calculate_nps();
+        info_string("calibration nps", nps);
+        if (nps > bestNPS) {
+            bestNPS = nps;
+            bestPartition = partition;
+        }
+    }
+    if (!bestPartition.inferenceCpus.empty()) {
+        apply_core_partition(bestPartition);
+    }
+}
+
 void CrazyAra::ucinewgame()
 {
     wait_to_finish_last_search();
@@ -420,23 +915,38 @@ unique_ptr<NeuralNetAPI> CrazyAra::create_new_net_single(const string& modelDire
 vector<unique_ptr<NeuralNetAPI>> CrazyAra::create_new_net_batches(const string& modelDirectory)
 {
     vector<unique_ptr<NeuralNetAPI>> netBatches;
+    for (int deviceId = int(Options["First_Device_ID"]); deviceId <= int(Options["Last_Device_ID"]); ++deviceId) {
+        for (size_t i = 0; i < size_t(Options["Threads"]); ++i) {
+            netBatches.push_back(create_new_net_batch(modelDirectory, deviceId, searchSettings.batchSize));
+        }
+    }
+    return netBatches;
+}
+
+#ifdef USE_RL
+void CrazyAra::create_shared_batches(const string& modelDirectory, size_t batchSize,
+                                     vector<unique_ptr<NeuralNetAPI>>& sharedNets, vector<unique_ptr<SharedBatch>>& sharedBatches)
+{
+    for (int deviceId = int(Options["First_Device_ID"]); deviceId <= int(Options["Last_Device_ID"]); ++deviceId) {
+        sharedNets.emplace_back(create_new_net_batch(modelDirectory, deviceId, batchSize));
+        sharedBatches.emplace_back(make_unique<SharedBatch>(sharedNets.back().get(), chrono::microseconds(rlSettings.sharedBatchTimeoutUS)));
+    }
+}
+#endif
+
+unique_ptr<NeuralNetAPI> CrazyAra::create_new_net_batch(const string& modelDirectory, int deviceId, unsigned int batchSize)
+{
 #ifdef MXNET
     #ifdef TENSORRT
         const bool useTensorRT = bool(Options["Use_TensorRT"]);
     #else
         const bool useTensorRT = false;
     #endif
+    return make_unique<MXNetAPI>(Options["Context"], deviceId, batchSize, modelDirectory, useTensorRT);
+#elif defined TENSORRT
+    return make_unique<TensorrtAPI>(deviceId, batchSize, modelDirectory, Options["Precision"]);
 #endif
-    for (int deviceId = int(Options["First_Device_ID"]); deviceId <= int(Options["Last_Device_ID"]); ++deviceId) {
-        for (size_t i = 0; i < size_t(Options["Threads"]); ++i) {
-    #ifdef MXNET
-            netBatches.push_back(make_unique<MXNetAPI>(Options["Context"], deviceId, searchSettings.batchSize, modelDirectory, useTensorRT));
-    #elif defined TENSORRT
-            netBatches.push_back(make_unique<TensorrtAPI>(deviceId, searchSettings.batchSize, modelDirectory, Options["Precision"]));
-    #endif
-        }
-    }
-    return netBatches;
+    return nullptr;
 }
 
 unique_ptr<MCTSAgent> CrazyAra::create_new_mcts_agent(NeuralNetAPI* netSingle, vector<unique_ptr<NeuralNetAPI>>& netBatches, StatesManager* states)
@@ -472,6 +982,15 @@ void CrazyAra::init_search_settings()
     is960 = Options["UCI_Chess960"];
 #endif
     searchSettings.useNPSTimemanager = Options["Use_NPS_Time_Manager"];
+    searchSettings.logSearchStatistics = Options["Log_Search_Statistics"];
+    searchSettings.compactTree = Options["Compact_Tree"];
+    searchSettings.compactLeafNodes = Options["Compact_Leaf_Nodes"];
+    searchSettings.policyMassThreshold = Options["Milli_Policy_Mass_Threshold"] / 1000.0f;
+    searchSettings.threadAffinity = thread_affinity_from_string(Options["Thread_Affinity"]);
+    const bool useHugePages = Options["Use_Huge_Pages"];
+    if (set_huge_pages(useHugePages) != useHugePages) {
+        info_string("huge pages are unavailable -> using the default heap");
+    }
     searchSettings.useRandomPlayout = Options["Random_Playout"];
     if (string(Options["SyzygyPath"]).empty() || string(Options["SyzygyPath"]) == "<empty>") {
         searchSettings.useTablebase = false;
@@ -43,6 +43,8 @@
 #include "agents/config/rlsettings.h"
 #endif
 
+class SharedBatch;
+
 class CrazyAra
 {
 private:
@@ -151,6 +153,36 @@ public:
      */
     void benchmark(istringstream& is);
 
+    /**
+     * @brief benchmark_thread_affinity Runs the benchmark positions for every thread affinity mode and prints the average NPS
+     * ("benchmark <movetime> numa")
+     * @param goCommand Go command which is used for every position
+     */
+    void benchmark_thread_affinity(const string& goCommand);
+
+    /**
+     * @brief benchmark_policy_truncation Runs the benchmark positions with the full policy and with the truncated policy
+     * (Milli_Policy_Mass_Threshold or 99.5% if disabled) and compares the passed positions, the chosen moves, the NPS and the bytes per node
+     * ("benchmark <movetime> truncation")
+     * @param goCommand Go command which is used for every position
+     */
+    void benchmark_policy_truncation(const string& goCommand);
+
+    /**
+     * @brief benchmark_tree_compaction Searches every benchmark position and afterwards the position after the first two moves
+     * of the principal variation, which reuses the subtree. Prints the average NPS of the searches on the reused tree
+     * without and with Compact_Tree ("benchmark <movetime> compact")
+     * @param goCommand Go command which is used for every position
+     */
+    void benchmark_tree_compaction(const string& goCommand);
+
+    /**
+     * @brief benchmark_leaf_compaction Runs the benchmark positions without and with Compact_Leaf_Nodes and compares the passed positions,
+     * the chosen moves, the NPS, the bytes per node and the bytes of the legal moves and priors per node ("benchmark <movetime> leaves")
+     * @param goCommand Go command which is used for every position
+     */
+    void benchmark_leaf_compaction(const string& goCommand);
+
 #ifdef USE_RL
     /**
      * @brief selfplay Starts self play for a given number of games
@@ -158,12 +190,36 @@ public:
      */
     void selfplay(istringstream &is);
 
+    /**
+     * @brief selfplay_concurrent Generates rlSettings.concurrentGames games at the same time, each with its own MCTSAgent.
+     * The leaf nodes of all games are evaluated in shared batches (one shared network per device).
+     * @param numberOfGames Number of games to generate (0 means until the export file is full)
+     */
+    void selfplay_concurrent(size_t numberOfGames);
+
+    /**
+     * @brief arena_concurrent Plays rlSettings.concurrentGames arena games at the same time.
+     * The leaf nodes of all games are evaluated in one shared batch per network and device.
+     * @param numberOfGames Maximum number of games to play (the arena stops earlier if the SPRT is enabled and decided)
+     * @return Tournament result from the perspective of the contender
+     */
+    TournamentResult arena_concurrent(size_t numberOfGames);
+
+    /**
+     * @brief export_benchmark Measures the throughput of the TrainDataExporter by exporting synthetic games
+     * of random length (default: 1000 games) into "export_benchmark.zarr" (or "export_benchmark.bin" for the compact format)
+     * @param is Number of games to export, optionally followed by "compact"
+     */
+    void export_benchmark(istringstream &is);
+
     /**
      * @brief arena Starts the arena comparision between two different NN weights.
      * The score can be used for logging and to decide if the current weights shall be replaced.
      * The arena ends with either the keywords "keep" or "replace".
      * "keep": Signals that the current generator should be kept
      * "replace": Signals that the current generator should be replaced by the contender
+     * If the SPRT is enabled (UCI option Arena_SPRT), the arena stops as soon as one hypothesis is accepted
+     * and the decision is based on it. Otherwise and for an undecided SPRT the contender needs a score above 50%.
      * @param is Number of games to generate
      */
     void arena(istringstream &is);
@@ -216,6 +272,49 @@ private:
      * @return Vector of pointers to the newly createded objects. For every thread a sepreate net.
      */
     vector<unique_ptr<NeuralNetAPI>> create_new_net_batches(const string& modelDirectory);
+
+    /**
+     * @brief create_new_net_batch Factory to create and load a single model with the given batch size
+     * @param modelDirectory Model directory where the .params and .json files are stored
+     * @param deviceId Device which is used for inference
+     * @param batchSize Batch size of the model
+     * @return Pointer to the newly created object
+     */
+    unique_ptr<NeuralNetAPI> create_new_net_batch(const string& modelDirectory, int deviceId, unsigned int batchSize);
+
+    /**
+     * @brief set_inference_threads Sets the number of worker and intra-op threads of the CPU inference runtime
+     * for the given core partition. Must be called before the first network is loaded.
+     * @param partition Core partition
+     */
+    void set_inference_threads(const CorePartition& partition);
+
+    /**
+     * @brief apply_core_partition Moves all current threads to the inference CPUs and lets the search threads pin themselves
+     * to the search CPUs at the start of every search
+     * @param partition Core partition
+     */
+    void apply_core_partition(const CorePartition& partition);
+
+    /**
+     * @brief calibrate_core_partition Runs a short search from the starting position with several numbers of search CPUs
+     * and applies the one with the highest NPS. The thread counts of the inference runtime are set once before the network
+     * is loaded, so the inference CPUs of the initial partition are kept and only the search-thread side is calibrated.
+     * @param initialPartition Partition which was used to size the inference runtime
+     */
+    void calibrate_core_partition(const CorePartition& initialPartition);
+
+#ifdef USE_RL
+    /**
+     * @brief create_shared_batches Creates a single shared network and batch per device for concurrently played games
+     * @param modelDirectory Model directory where the .params and .json files are stored
+     * @param batchSize Batch size of the shared networks, which should hold the batches of all search threads of the games on a device
+     * @param sharedNets Output for the shared networks
+     * @param sharedBatches Output for the shared batches
+     */
+    void create_shared_batches(const string& modelDirectory, size_t batchSize,
+                               vector<unique_ptr<NeuralNetAPI>>& sharedNets, vector<unique_ptr<SharedBatch>>& sharedBatches);
+#endif
 };
 
 /**
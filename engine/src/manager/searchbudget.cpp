@@ -0,0 +1,128 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: searchbudget.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "searchbudget.h"
+#include <algorithm>
+
+SearchBudget::SearchBudget():
+    remainingPlayouts(0),
+    claimedPlayouts(0),
+    deadline(0),
+    stopped(false),
+    limitPlayouts(false),
+    limitTime(false)
+{
+}
+
+void SearchBudget::reset(size_t playouts, size_t movetimeMS)
+{
+    limitPlayouts = playouts != 0;
+    limitTime = movetimeMS != 0;
+    remainingPlayouts = playouts;
+    claimedPlayouts = 0;
+    deadline = (chrono::steady_clock::now() + chrono::milliseconds(movetimeMS)).time_since_epoch().count();
+    stopped = false;
+}
+
+size_t SearchBudget::claim(size_t requested)
+{
+    if (stopped || is_deadline_reached()) {
+        return 0;
+    }
+    if (!limitPlayouts) {
+        return requested;
+    }
+    // the claim is registered before the playouts are taken from the budget, so is_exhausted() can't see an empty budget in between
+    claimedPlayouts += requested;
+    size_t remaining = remainingPlayouts;
+    size_t granted;
+    do {
+        granted = min(requested, remaining);
+        if (granted == 0) {
+            break;
+        }
+    } while (!remainingPlayouts.compare_exchange_weak(remaining, remaining - granted));
+    if (granted != requested && claimedPlayouts.fetch_sub(requested - granted) == requested - granted) {
+        // the budget might have been exhausted while this claim was registered
+        notify_waiting_threads();
+    }
+    return granted;
+}
+
+void SearchBudget::settle(size_t claimed, size_t used)
+{
+    if (!limitPlayouts) {
+        return;
+    }
+    // the unused playouts are returned before the claim is released, so is_exhausted() can't see an empty budget in between
+    remainingPlayouts += claimed - used;
+    if (claimedPlayouts.fetch_sub(claimed) == claimed || claimed != used) {
+        // playouts are available again or the budget is exhausted
+        notify_waiting_threads();
+    }
+}
+
+void SearchBudget::wait_for_playouts()
+{
+    unique_lock<mutex> lock(mtx);
+    while (remainingPlayouts == 0 && !is_exhausted()) {
+        if (limitTime) {
+            cv.wait_until(lock, chrono::steady_clock::time_point(chrono::steady_clock::duration(deadline.load())));
+        }
+        else {
+            cv.wait(lock);
+        }
+    }
+}
+
+void SearchBudget::notify_waiting_threads()
+{
+    {
+        // a thread which has just checked the budget in wait_for_playouts() is waiting on the condition variable after the mutex is released
+        lock_guard<mutex> lock(mtx);
+    }
+    cv.notify_all();
+}
+
+bool SearchBudget::is_exhausted() const
+{
+    if (stopped || is_deadline_reached()) {
+        return true;
+    }
+    // claimedPlayouts must be read first, see claim() and settle()
+    return limitPlayouts && claimedPlayouts == 0 && remainingPlayouts == 0;
+}
+
+void SearchBudget::extend_deadline(size_t timeMS)
+{
+    deadline += chrono::duration_cast<chrono::steady_clock::duration>(chrono::milliseconds(timeMS)).count();
+}
+
+void SearchBudget::stop()
+{
+    stopped = true;
+    notify_waiting_threads();
+}
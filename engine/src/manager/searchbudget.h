@@ -0,0 +1,118 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: searchbudget.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Playout budget and deadline of a search which are shared by all search threads.
+ * The threads reserve their playouts batch by batch before selecting the nodes,
+ * so the node limit is met exactly and the deadline is checked once per batch.
+ */
+
+#ifndef SEARCHBUDGET_H
+#define SEARCHBUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * @brief The SearchBudget class hands out the playouts (expanded nodes or transpositions) of a search.
+ * Each search thread claims up to a batch of playouts, selects the nodes and settles the number of playouts it actually used.
+ * Unused playouts are returned to the budget and can be claimed by other threads.
+ */
+class SearchBudget
+{
+private:
+    // playouts which haven't been claimed yet
+    atomic<size_t> remainingPlayouts;
+    // playouts which have been claimed by batches which aren't settled yet (or are requested by a running claim())
+    atomic<size_t> claimedPlayouts;
+    // steady clock ticks of the deadline
+    atomic<chrono::steady_clock::rep> deadline;
+    atomic<bool> stopped;
+    bool limitPlayouts;
+    bool limitTime;
+    // wakes up the threads in wait_for_playouts() when playouts are returned or the search ends
+    mutex mtx;
+    condition_variable cv;
+
+    /**
+     * @brief notify_waiting_threads Wakes up all threads in wait_for_playouts() after the budget has been changed
+     */
+    void notify_waiting_threads();
+
+    inline bool is_deadline_reached() const {
+        return limitTime && chrono::steady_clock::now().time_since_epoch().count() >= deadline;
+    }
+
+public:
+    SearchBudget();
+
+    /**
+     * @brief reset Initializes the budget for a new search. Must be called before the search threads are started.
+     * @param playouts Number of playouts (0: unlimited)
+     * @param movetimeMS Time until the deadline in milliseconds (0: unlimited)
+     */
+    void reset(size_t playouts, size_t movetimeMS);
+
+    /**
+     * @brief claim Reserves up to the given number of playouts
+     * @param requested Number of requested playouts (e.g. the batch size)
+     * @return Number of granted playouts. 0 if the budget is exhausted, the search was stopped or the deadline has been reached.
+     */
+    size_t claim(size_t requested);
+
+    /**
+     * @brief settle Finishes a claim and returns the unused playouts to the budget
+     * @param claimed Playouts which were granted by claim()
+     * @param used Playouts which have been used
+     */
+    void settle(size_t claimed, size_t used);
+
+    /**
+     * @brief wait_for_playouts Blocks until playouts can be claimed again or the search is over.
+     * Is called by a search thread whose claim failed, because all remaining playouts are claimed by batches of other threads.
+     */
+    void wait_for_playouts();
+
+    /**
+     * @brief is_exhausted Returns true if all playouts have been used, the search was stopped or the deadline has been reached
+     */
+    bool is_exhausted() const;
+
+    /**
+     * @brief extend_deadline Moves the deadline further into the future
+     * @param timeMS Additional time in milliseconds
+     */
+    void extend_deadline(size_t timeMS);
+
+    /**
+     * @brief stop Stops the search, all following claims will fail
+     */
+    void stop();
+};
+
+#endif // SEARCHBUDGET_H
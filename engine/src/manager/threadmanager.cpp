@@ -25,11 +25,14 @@
 
 #include "threadmanager.h"
 #include <chrono>
+#include "../util/tracer.h"
 
-ThreadManager::ThreadManager(Node* rootNode, vector<SearchThread*>& searchThreads, LoggerThread* loggerThread, size_t movetimeMS, size_t updateIntervalMS, float overallNPS, float lastValueEval):
+ThreadManager::ThreadManager(Node* rootNode, vector<SearchThread*>& searchThreads, LoggerThread* loggerThread, SearchBudget* searchBudget,
+                             size_t movetimeMS, size_t updateIntervalMS, float overallNPS, float lastValueEval):
     rootNode(rootNode),
     searchThreads(searchThreads),
     loggerThread(loggerThread),
+    searchBudget(searchBudget),
     movetimeMS(movetimeMS),
     remainingMoveTimeMS(movetimeMS),
     updateIntervalMS(updateIntervalMS),
@@ -48,6 +51,7 @@ void ThreadManager::await_kill_signal()
 
 void run_thread_manager(ThreadManager* t)
 {
+    tracer.set_thread_name("thread manager");
     if (t->get_movetime_ms() == 0) {
         t->stop_search_based_on_kill_event();
     }
@@ -58,11 +62,12 @@ void run_thread_manager(ThreadManager* t)
 
 void ThreadManager::stop_search_based_on_limits()
 {
-    do {
+    while (true) {
         remainingMoveTimeMS = movetimeMS;
         for (size_t var = 0; var < movetimeMS / updateIntervalMS && isRunning; ++var) {
             if (wait_for(chrono::milliseconds(updateIntervalMS))){
                 remainingMoveTimeMS -= updateIntervalMS;
+                TraceSpan span("check_stopping");
                 if (checkedContinueSearch == 0 && early_stopping() && !continue_search()) {
                     stop_search();
                 }
@@ -71,12 +76,14 @@ void ThreadManager::stop_search_based_on_limits()
                 return;
             }
         }
-    } while(continue_search());
-
-    if (!wait_for(chrono::milliseconds(movetimeMS % updateIntervalMS))){
-        return;
+        // the continuation is checked up to one update interval before the deadline, so the search threads keep running
+        if (!continue_search()) {
+            break;
+        }
+        searchBudget->extend_deadline(movetimeMS);
     }
-    stop_search();
+    // the search threads stop at the deadline, afterwards the manager is killed
+    await_kill_signal();
 }
 
 void ThreadManager::stop_search_based_on_kill_event()
@@ -137,6 +144,8 @@ bool ThreadManager::continue_search() {
 
 void ThreadManager::stop_search()
 {
+    TraceSpan span("stop_search");
+    searchBudget->stop();
     stop_search_threads(searchThreads);
     loggerThread->kill();
 }
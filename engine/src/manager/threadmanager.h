@@ -33,6 +33,7 @@
 #include "../searchthread.h"
 #include "../agents/util/loggerthread.h"
 #include "../util/killablethread.h"
+#include "searchbudget.h"
 #include <condition_variable>
 
 using namespace std;
@@ -47,6 +48,7 @@ private:
     Node* rootNode;
     vector<SearchThread*> searchThreads;
     LoggerThread* loggerThread;
+    SearchBudget* searchBudget;
     size_t movetimeMS;
     size_t remainingMoveTimeMS;
     size_t updateIntervalMS;
@@ -68,12 +70,12 @@ private:
     inline bool continue_search();
 
 public:
-    ThreadManager(Node* rootNode, vector<SearchThread*>& searchThreads, LoggerThread* loggerThread, size_t movetimeMS, size_t updateIntervalMS, float overallNPS, float lastValueEval);
+    ThreadManager(Node* rootNode, vector<SearchThread*>& searchThreads, LoggerThread* loggerThread, SearchBudget* searchBudget,
+                  size_t movetimeMS, size_t updateIntervalMS, float overallNPS, float lastValueEval);
 
     /**
-    * @brief stop_search_based_on_limits Checks for the search limit condition and possible early break-ups
-    * and stops all running search threads accordingly
-    * @param evalInfo Evaluation struct which updated during search
+    * @brief stop_search_based_on_limits Checks for possible early break-ups and extends the deadline of the search budget
+    * if the search should be continued. The search threads stop themselves when the deadline has been reached.
     */
     void stop_search_based_on_limits();
 
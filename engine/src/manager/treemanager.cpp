@@ -47,3 +47,17 @@ bool same_hash_key(Node* node, Board *pos)
             node->hash_key() == pos->hash_key() &&
             node->plies_from_null() == pos->get_state_info()->pliesFromNull;
 }
+
+Node* compact_tree(Node* rootNode, HashTable& hashTable)
+{
+    Node* newRootNode = new Node(std::move(*rootNode));
+    replace_hash_entry(hashTable, rootNode, newRootNode);
+    delete rootNode;
+
+    // every node is relocated by its parent, the list is processed in breadth-first order while it grows
+    vector<Node*> relocatedNodes = {newRootNode};
+    for (size_t idx = 0; idx < relocatedNodes.size(); ++idx) {
+        relocatedNodes[idx]->relocate_child_nodes(hashTable, relocatedNodes);
+    }
+    return newRootNode;
+}
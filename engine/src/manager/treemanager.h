@@ -48,4 +48,15 @@ Node* pick_next_node(Move move, const Node* parentNode);
  */
 bool same_hash_key(Node* node, Board *pos);
 
+/**
+ * @brief compact_tree Copies the tree of the given root node into new memory in breadth-first order.
+ * The child nodes of every node are stored in new child blocks and all parent, child and hash table pointers are updated.
+ * This undoes the fragmentation of a reused subtree whose nodes were allocated over several earlier searches.
+ * Must not be called during the search.
+ * @param rootNode Root node of the tree, it is deleted
+ * @param hashTable Hash table of the tree
+ * @return New root node
+ */
+Node* compact_tree(Node* rootNode, HashTable& hashTable);
+
 #endif // TREEMANAGER_H
@@ -97,6 +97,22 @@ unsigned int NeuralNetAPI::get_policy_output_length() const
     return policyOutputLength;
 }
 
+unsigned int NeuralNetAPI::get_batch_size() const
+{
+    return batchSize;
+}
+
+void NeuralNetAPI::predict_positions(float* inputPlanes, float* valueOutput, float* probOutputs, size_t)
+{
+    // the batch size of the network is fixed
+    predict(inputPlanes, valueOutput, probOutputs);
+}
+
+void NeuralNetAPI::set_active(bool)
+{
+    // a network which is exclusively used by a single search thread doesn't need to track its clients
+}
+
 bool NeuralNetAPI::file_exists(const string& name)
 {
     struct stat buffer;
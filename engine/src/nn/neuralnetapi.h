@@ -95,8 +95,29 @@ public:
      */
     virtual void predict(float* inputPlanes, float* valueOutput, float* probOutputs) = 0;
 
+    /**
+     * @brief predict_positions Runs a prediction on the first numberPositions positions of the input planes.
+     * The outputs of the remaining positions of the batch are undefined.
+     * By default the full batch is evaluated, networks which are shared between several searches only evaluate the given positions.
+     * @param numberPositions Number of valid positions (at most the batch size)
+     */
+    virtual void predict_positions(float* inputPlanes, float* valueOutput, float* probOutputs, size_t numberPositions);
+
     unsigned int get_policy_output_length() const;
 
+    /**
+     * @brief get_batch_size Returns the constant batch size which is used for inference
+     * @return unsigned int
+     */
+    unsigned int get_batch_size() const;
+
+    /**
+     * @brief set_active Is called by a search thread when it starts (true) and stops (false) sending requests to this network.
+     * Only relevant for networks which are shared between several searches, e.g. SharedBatchClientAPI.
+     * @param active True if the search thread has started
+     */
+    virtual void set_active(bool active);
+
 protected:
     /**
      * @brief FileExists Function to check if a file exists in a given path
@@ -0,0 +1,206 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: sharedbatchapi.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "sharedbatchapi.h"
+#include <cstring>
+#include <stdexcept>
+#include "../domain/crazyhouse/constants.h"
+
+SharedBatch::SharedBatch(NeuralNetAPI* net, chrono::microseconds timeout):
+    net(net),
+    capacity(net->get_batch_size()),
+    policyLengthPerPosition(net->get_policy_output_length() / net->get_batch_size()),
+    timeout(timeout),
+    filledPositions(0),
+    activeClients(0),
+    generation(0),
+    numberBatches(0),
+    numberEvaluatedPositions(0)
+{
+    inputPlanes = new float[capacity * NB_VALUES_TOTAL];
+    fill(inputPlanes, inputPlanes + capacity * NB_VALUES_TOTAL, 0.0f);
+    valueOutputs = new float[capacity];
+    probOutputs = new float[net->get_policy_output_length()];
+}
+
+SharedBatch::~SharedBatch()
+{
+    delete [] inputPlanes;
+    for (float* freePlanes : freeInputPlanes) {
+        delete [] freePlanes;
+    }
+    delete [] valueOutputs;
+    delete [] probOutputs;
+}
+
+void SharedBatch::flush(unique_lock<mutex>& lock)
+{
+    // swap the pending batch out, so that the next batch can be filled during the inference
+    vector<Request> batchRequests;
+    batchRequests.swap(requests);
+    float* batchInputPlanes = inputPlanes;
+    const size_t batchPositions = filledPositions;
+    if (freeInputPlanes.empty()) {
+        inputPlanes = new float[capacity * NB_VALUES_TOTAL];
+        fill(inputPlanes, inputPlanes + capacity * NB_VALUES_TOTAL, 0.0f);
+    }
+    else {
+        inputPlanes = freeInputPlanes.back();
+        freeInputPlanes.pop_back();
+    }
+    filledPositions = 0;
+    ++generation;
+    // clients which are waiting for free space can continue
+    cv.notify_all();
+    lock.unlock();
+
+    {
+        lock_guard<mutex> inferenceLock(inferenceMtx);
+        net->predict(batchInputPlanes, valueOutputs, probOutputs);
+        for (const Request& request : batchRequests) {
+            memcpy(request.valueOutputs, valueOutputs + request.offset, request.numberPositions * sizeof(float));
+            memcpy(request.probOutputs, probOutputs + request.offset * policyLengthPerPosition,
+                   request.numberPositions * policyLengthPerPosition * sizeof(float));
+        }
+    }
+
+    lock.lock();
+    freeInputPlanes.push_back(batchInputPlanes);
+    for (const Request& request : batchRequests) {
+        *request.done = true;
+    }
+    ++numberBatches;
+    numberEvaluatedPositions += batchPositions;
+    cv.notify_all();
+}
+
+void SharedBatch::predict(float* inputPlanes, float* valueOutputs, float* probOutputs, size_t numberPositions)
+{
+    if (numberPositions > capacity) {
+        throw invalid_argument("The request of " + to_string(numberPositions) + " positions exceeds the shared batch size of "
+                               + to_string(capacity));
+    }
+    unique_lock<mutex> lock(mtx);
+    // the request doesn't fit anymore, so the pending batch is evaluated right away and the request is added to the next batch
+    while (filledPositions + numberPositions > capacity) {
+        flush(lock);
+    }
+    memcpy(this->inputPlanes + filledPositions * NB_VALUES_TOTAL, inputPlanes, numberPositions * NB_VALUES_TOTAL * sizeof(float));
+    bool done = false;
+    requests.push_back({valueOutputs, probOutputs, numberPositions, filledPositions, &done});
+    filledPositions += numberPositions;
+    const size_t requestGeneration = generation;
+
+    if (filledPositions == capacity || requests.size() >= activeClients) {
+        flush(lock);
+        return;
+    }
+    while (!done) {
+        // only the batch which still contains the request is flushed, a batch which has already been handed over is awaited
+        if (!cv.wait_for(lock, timeout, [&]{ return done; }) && generation == requestGeneration) {
+            flush(lock);
+        }
+    }
+}
+
+void SharedBatch::add_clients(size_t number)
+{
+    lock_guard<mutex> lock(mtx);
+    activeClients += number;
+}
+
+void SharedBatch::remove_clients(size_t number)
+{
+    unique_lock<mutex> lock(mtx);
+    activeClients -= number;
+    // the remaining clients might be waiting for the removed ones
+    if (!requests.empty() && requests.size() >= activeClients) {
+        flush(lock);
+    }
+}
+
+NeuralNetAPI* SharedBatch::get_net() const
+{
+    return net;
+}
+
+float SharedBatch::get_average_fill()
+{
+    lock_guard<mutex> lock(mtx);
+    if (numberBatches == 0) {
+        return 0;
+    }
+    return float(numberEvaluatedPositions) / (numberBatches * capacity);
+}
+
+SharedBatchClientAPI::SharedBatchClientAPI(SharedBatch* sharedBatch, const string& ctx, int deviceID, unsigned int batchSize, const string& modelDirectory):
+    NeuralNetAPI(ctx, deviceID, batchSize, modelDirectory, false),
+    sharedBatch(sharedBatch)
+{
+    check_if_policy_map();
+}
+
+void SharedBatchClientAPI::predict(float* inputPlanes, float* valueOutput, float* probOutputs)
+{
+    sharedBatch->predict(inputPlanes, valueOutput, probOutputs, batchSize);
+}
+
+void SharedBatchClientAPI::predict_positions(float* inputPlanes, float* valueOutput, float* probOutputs, size_t numberPositions)
+{
+    sharedBatch->predict(inputPlanes, valueOutput, probOutputs, numberPositions);
+}
+
+void SharedBatchClientAPI::set_active(bool active)
+{
+    if (active) {
+        sharedBatch->add_clients(1);
+    }
+    else {
+        sharedBatch->remove_clients(1);
+    }
+}
+
+void SharedBatchClientAPI::load_model()
+{
+    // the model is loaded by the shared network
+}
+
+void SharedBatchClientAPI::load_parameters()
+{
+    // the parameters are loaded by the shared network
+}
+
+void SharedBatchClientAPI::bind_executor()
+{
+    // the executor is bound by the shared network
+}
+
+void SharedBatchClientAPI::check_if_policy_map()
+{
+    const NeuralNetAPI* net = sharedBatch->get_net();
+    isPolicyMap = net->is_policy_map();
+    policyOutputLength = net->get_policy_output_length() / net->get_batch_size() * batchSize;
+}
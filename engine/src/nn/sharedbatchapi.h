@@ -0,0 +1,173 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: sharedbatchapi.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Merges the inference requests of several independent searches (e.g. concurrently generated self-play games)
+ * into large shared batches of a single network.
+ */
+
+#ifndef SHAREDBATCHAPI_H
+#define SHAREDBATCHAPI_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "neuralnetapi.h"
+
+using namespace std;
+
+/**
+ * @brief The SharedBatch class collects the requests of all clients and runs the network once the batch is full,
+ * all active clients are waiting, a request doesn't fit anymore or the timeout of the oldest request has been exceeded.
+ * The inference itself is done by the client thread which triggered the flush. It runs outside of the request mutex,
+ * so other clients can already fill the next batch in the meantime.
+ */
+class SharedBatch
+{
+private:
+    struct Request {
+        float* valueOutputs;
+        float* probOutputs;
+        size_t numberPositions;
+        size_t offset;
+        // is set after the outputs have been written
+        bool* done;
+    };
+
+    NeuralNetAPI* net;
+    // number of positions which can be evaluated in a single batch
+    size_t capacity;
+    size_t policyLengthPerPosition;
+    chrono::microseconds timeout;
+
+    mutex mtx;
+    condition_variable cv;
+    vector<Request> requests;
+    size_t filledPositions;
+    // number of clients which are still able to send requests
+    size_t activeClients;
+    // is incremented whenever the pending batch is handed over to the inference
+    size_t generation;
+    // input planes of the pending batch and unused buffers of already evaluated batches
+    float* inputPlanes;
+    vector<float*> freeInputPlanes;
+
+    // serializes the inference of batches which have been flushed concurrently
+    mutex inferenceMtx;
+    float* valueOutputs;
+    float* probOutputs;
+
+    size_t numberBatches;
+    size_t numberEvaluatedPositions;
+
+    /**
+     * @brief flush Hands the pending requests over to the inference, runs the network on them without holding the mutex
+     * and wakes up the waiting clients
+     * @param lock Lock of the mutex, which is held before and after the call
+     */
+    void flush(unique_lock<mutex>& lock);
+
+public:
+    /**
+     * @brief SharedBatch
+     * @param net Network which is used for all requests. Its batch size defines the capacity of the shared batch.
+     * @param timeout Maximum time to wait for further requests before an incompletely filled batch is evaluated
+     */
+    SharedBatch(NeuralNetAPI* net, chrono::microseconds timeout);
+    ~SharedBatch();
+    SharedBatch(const SharedBatch&) = delete;
+    SharedBatch& operator=(const SharedBatch&) = delete;
+
+    /**
+     * @brief predict Adds the given positions to the shared batch and blocks until they have been evaluated
+     * @param inputPlanes Input planes of numberPositions positions
+     * @param valueOutputs Output for the value predictions
+     * @param probOutputs Output for the policy predictions
+     * @param numberPositions Number of valid positions of the request (at most the batch size of the client)
+     */
+    void predict(float* inputPlanes, float* valueOutputs, float* probOutputs, size_t numberPositions);
+
+    /**
+     * @brief add_clients Registers clients which will send requests. The shared batch will only wait for registered clients.
+     * @param number Number of clients
+     */
+    void add_clients(size_t number);
+
+    /**
+     * @brief remove_clients Unregisters clients which won't send any further requests
+     * @param number Number of clients
+     */
+    void remove_clients(size_t number);
+
+    NeuralNetAPI* get_net() const;
+
+    /**
+     * @brief get_average_fill Returns the average number of requested positions per batch relative to the capacity
+     * @return float in [0, 1]
+     */
+    float get_average_fill();
+};
+
+/**
+ * @brief The SharedBatchClientAPI class is a proxy network which forwards all predictions to a SharedBatch object
+ */
+class SharedBatchClientAPI : public NeuralNetAPI
+{
+private:
+    SharedBatch* sharedBatch;
+
+public:
+    /**
+     * @brief SharedBatchClientAPI
+     * @param sharedBatch Shared batch which evaluates the requests
+     * @param ctx Computation contex either "cpu" or "gpu"
+     * @param deviceID Device ID of the shared network
+     * @param batchSize Batch size of this client (must not exceed the capacity of the shared batch)
+     * @param modelDirectory Directory of the shared network
+     */
+    SharedBatchClientAPI(SharedBatch* sharedBatch, const string& ctx, int deviceID, unsigned int batchSize, const string& modelDirectory);
+
+    void predict(float* inputPlanes, float* valueOutput, float* probOutputs) override;
+
+    /**
+     * @brief predict_positions Only sends the given positions to the shared batch, so that the batch can be filled with the positions of other clients
+     */
+    void predict_positions(float* inputPlanes, float* valueOutput, float* probOutputs, size_t numberPositions) override;
+
+    /**
+     * @brief set_active Registers or unregisters the calling search thread as a client of the shared batch,
+     * so that the shared batch doesn't wait for idle searches (e.g. the passive player of an arena game
+     * or a search thread which waits for playouts)
+     */
+    void set_active(bool active) override;
+
+protected:
+    void load_model() override;
+    void load_parameters() override;
+    void bind_executor() override;
+    void check_if_policy_map() override;
+};
+
+#endif // SHAREDBATCHAPI_H
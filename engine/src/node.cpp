@@ -25,10 +25,13 @@
 
 #include "node.h"
 #include "syzygy/tbprobe.h"
+#include "misc.h"
 #include "util/blazeutil.h" // get_dirichlet_noise()
 #include "constants.h"
 #include "../util/sfutil.h"
 #include "../util/communication.h"
+#include "../util/lockstatistics.h"
+#include "../util/memorystatistics.h"
 
 
 bool Node::is_sorted() const
@@ -40,18 +43,25 @@ Node::Node(Board *pos, bool inCheck, Node *parentNode, size_t childIdxForParent,
     parentNode(parentNode),
     key(pos->get_state_info()->key),
     value(0),
+    tailPolicyMass(0),
     d(nullptr),
     childIdxForParent(childIdxForParent),
+    numberChildNodes(0),
+    numberTailMoves(0),
     pliesFromNull(pos->get_state_info()->pliesFromNull),
     isTerminal(false),
     isTablebase(false),
     hasNNResults(false),
-    sorted(false)
+    sorted(false),
+    deferredMoves(searchSettings->compactLeafNodes && parentNode != nullptr)
 {
-    fill_child_node_moves(pos);
+    // most leaf nodes are never visited again, so their moves are only generated together with the prior policy
+    if (!deferredMoves) {
+        fill_child_node_moves(pos);
 
-    // specify the number of direct child nodes of this node
-    const int numberChildNodes = legalMoves.size();
+        // specify the number of direct child nodes of this node
+        numberChildNodes = legalMoves.size();
+    }
 
     check_for_terminal(pos, inCheck);
 #ifdef MODE_CHESS
@@ -60,6 +70,7 @@ Node::Node(Board *pos, bool inCheck, Node *parentNode, size_t childIdxForParent,
     }
 #endif
     policyProbSmall.resize(numberChildNodes);
+    update_memory_statistics(1);
 }
 
 Node::Node(const Node &b)
@@ -68,10 +79,16 @@ Node::Node(const Node &b)
     set_value(b.updated_value_eval());
     key = b.key;
     pliesFromNull = b.plies_from_null();
-    const int numberChildNodes = b.legalMoves.size();
+    numberChildNodes = b.numberChildNodes;
+    numberTailMoves = b.numberTailMoves;
+    tailPolicyMass = b.tailPolicyMass;
     policyProbSmall.resize(numberChildNodes);
     policyProbSmall = b.policyProbSmall;
     legalMoves = b.legalMoves;
+    if (b.compactPolicy != nullptr) {
+        compactPolicy = make_unique<uint16_t[]>(numberChildNodes);
+        copy_n(b.compactPolicy.get(), numberChildNodes, compactPolicy.get());
+    }
     isTerminal = b.isTerminal;
     //    parentNode = // is not copied
     //    childIdxForParent = // is not copied
@@ -79,8 +96,34 @@ Node::Node(const Node &b)
     isTablebase = b.isTablebase;
     hasNNResults = b.hasNNResults;
     sorted = b.sorted;
-    d = make_unique<NodeData>(numberChildNodes);
+    deferredMoves = b.deferredMoves;
+    d = make_unique<NodeData>(numberChildNodes + numberTailMoves);
     // TODO: Allow copying checkmateIndex
+    update_memory_statistics(1);
+}
+
+Node::Node(Node&& b):
+    policyProbSmall(std::move(b.policyProbSmall)),
+    legalMoves(std::move(b.legalMoves)),
+    compactPolicy(std::move(b.compactPolicy)),
+    parentNode(b.parentNode),
+    key(b.key),
+    value(b.value),
+    tailPolicyMass(b.tailPolicyMass),
+    d(std::move(b.d)),
+    childIdxForParent(b.childIdxForParent),
+    numberChildNodes(b.numberChildNodes),
+    numberTailMoves(b.numberTailMoves),
+    pliesFromNull(b.pliesFromNull),
+    isTerminal(b.isTerminal),
+    isTablebase(b.isTablebase),
+    hasNNResults(b.hasNNResults),
+    sorted(b.sorted),
+    deferredMoves(b.deferredMoves)
+{
+    // the vectors stay accounted because they have been moved, only the node itself is new
+    memoryStatistics.add_nodes(1);
+    memoryStatistics.add(MEM_NODE, int64_t(sizeof(Node)));
 }
 
 void Node::fill_child_node_moves(Board* pos)
@@ -278,8 +321,109 @@ bool Node::is_root_node() const
     return parentNode == nullptr;
 }
 
+LockClass Node::get_lock_class() const
+{
+    if (parentNode == nullptr) {
+        return LOCK_ROOT_NODE;
+    }
+    const Node* grandParentNode = parentNode->parentNode;
+    if (grandParentNode == nullptr || grandParentNode->parentNode == nullptr) {
+        return LOCK_SHALLOW_NODE;
+    }
+    return LOCK_DEEP_NODE;
+}
+
 Node::~Node()
 {
+    update_memory_statistics(-1);
+}
+
+void* Node::operator new(size_t bytes)
+{
+    // the prefix of a single node is a nullptr instead of the pointer to a child block
+    char* memory = static_cast<char*>(allocate_tree_memory(NODE_PREFIX_BYTES + bytes));
+    *reinterpret_cast<ChildBlock**>(memory) = nullptr;
+    return memory + NODE_PREFIX_BYTES;
+}
+
+void Node::operator delete(void* ptr, size_t bytes)
+{
+    char* memory = static_cast<char*>(ptr) - NODE_PREFIX_BYTES;
+    ChildBlock* childBlock = *reinterpret_cast<ChildBlock**>(memory);
+    if (childBlock == nullptr) {
+        deallocate_tree_memory(memory, NODE_PREFIX_BYTES + bytes);
+        return;
+    }
+    // the slot is still accounted by the child block
+    memoryStatistics.add(MEM_NODE, int64_t(sizeof(Node)));
+    childBlock->release();
+}
+
+void Node::relocate_child_nodes(HashTable& hashTable, vector<Node*>& relocatedNodes)
+{
+    // the move constructor kept the arrays of this node at their old address, so they are copied next to the relocated node
+    update_memory_statistics(-1);
+    policyProbSmall = DynamicVector<float>(policyProbSmall);
+    vector<Move>(legalMoves).swap(legalMoves);
+    if (compactPolicy != nullptr) {
+        unique_ptr<uint16_t[]> newCompactPolicy = make_unique<uint16_t[]>(numberChildNodes);
+        copy_n(compactPolicy.get(), numberChildNodes, newCompactPolicy.get());
+        compactPolicy = std::move(newCompactPolicy);
+    }
+    update_memory_statistics(1);
+
+    if (d == nullptr) {
+        return;
+    }
+    // the old node data keeps the old child blocks until all children have been moved out of them
+    unique_ptr<NodeData> oldData = std::move(d);
+    // same reservation as in add_unvisited_child()
+    const size_t reservedChildNodes = oldData->noVisitIdx >= PRESERVED_ITEMS ? get_number_child_nodes() : min(size_t(PRESERVED_ITEMS), get_number_child_nodes());
+    d = make_unique<NodeData>(*oldData, reservedChildNodes);
+    for (size_t childIdx = 0; childIdx < d->childNodes.size(); ++childIdx) {
+        Node* oldChildNode = d->childNodes[childIdx];
+        if (oldChildNode == nullptr) {
+            continue;
+        }
+        void* memory = allocate_child_memory(childIdx);
+        Node* newChildNode = memory != nullptr ? new (memory) Node(std::move(*oldChildNode)) : new Node(std::move(*oldChildNode));
+        newChildNode->parentNode = this;
+        d->childNodes[childIdx] = newChildNode;
+        replace_hash_entry(hashTable, oldChildNode, newChildNode);
+        delete oldChildNode;
+        relocatedNodes.push_back(newChildNode);
+    }
+}
+
+void* Node::allocate_child_memory(size_t childIdx)
+{
+    const size_t blockIdx = child_block_index(childIdx);
+    lock();
+    ChildBlock*& childBlock = d->childBlocks[blockIdx];
+    if (childBlock == nullptr) {
+        // the child nodes are sorted by their prior, so the large blocks of the unlikely moves are rarely allocated
+        const size_t firstChildIdx = child_block_begin(blockIdx);
+        const size_t endChildIdx = blockIdx + 1 < NB_CHILD_BLOCKS ? min(child_block_begin(blockIdx + 1), get_number_child_nodes()) : get_number_child_nodes();
+        childBlock = ChildBlock::create(firstChildIdx, endChildIdx - firstChildIdx, sizeof(Node));
+    }
+    void* memory = childBlock->claim_slot(childIdx);
+    unlock();
+    if (memory != nullptr) {
+        // the constructor accounts the node again
+        memoryStatistics.add(MEM_NODE, -int64_t(sizeof(Node)));
+    }
+    return memory;
+}
+
+void Node::update_memory_statistics(int64_t sign) const
+{
+    memoryStatistics.add_nodes(sign);
+    memoryStatistics.add(MEM_NODE, sign * int64_t(sizeof(Node)));
+    memoryStatistics.add(MEM_LEGAL_MOVES, sign * int64_t(legalMoves.capacity() * sizeof(Move)));
+    memoryStatistics.add(MEM_POLICY, sign * int64_t(policyProbSmall.capacity() * sizeof(float)));
+    if (compactPolicy != nullptr) {
+        memoryStatistics.add(MEM_POLICY, sign * int64_t(numberChildNodes * sizeof(uint16_t)));
+    }
 }
 
 void Node::sort_moves_by_probabilities()
@@ -340,14 +484,21 @@ void Node::reserve_full_memory()
 void Node::increment_no_visit_idx()
 {
     lock();
+    add_unvisited_child();
+    unlock();
+}
+
+void Node::add_unvisited_child()
+{
     if (d->noVisitIdx < get_number_child_nodes()) {
         ++d->noVisitIdx;
+        const size_t reservedMemory = d->dynamic_memory();
         if (d->noVisitIdx == PRESERVED_ITEMS) {
             reserve_full_memory();
         }
         d->add_empty_node();
+        memoryStatistics.add(MEM_NODE_DATA, int64_t(d->dynamic_memory()) - int64_t(reservedMemory));
     }
-    unlock();
 }
 
 float Node::get_value() const
@@ -362,13 +513,133 @@ Key Node::hash_key() const
 
 size_t Node::get_number_child_nodes() const
 {
-    return legalMoves.size();
+    return numberChildNodes;
 }
 
 void Node::prepare_node_for_visits()
 {
     sort_moves_by_probabilities();
-    init_node_data();
+    init_node_data(numberChildNodes + numberTailMoves);
+}
+
+void Node::compress_policy()
+{
+    if (is_root_node() || isTerminal || sorted || compactPolicy != nullptr) {
+        return;
+    }
+    update_memory_statistics(-1);
+    const vector<size_t> p = sort_permutation(legalMoves, std::less<Move>());
+    compactPolicy = make_unique<uint16_t[]>(numberChildNodes);
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        compactPolicy[idx] = float_to_half(policyProbSmall[p[idx]]);
+    }
+    vector<Move>().swap(legalMoves);
+    DynamicVector<float>().swap(policyProbSmall);
+    update_memory_statistics(1);
+}
+
+void Node::restore_moves_and_policy(Board* pos)
+{
+    if (compactPolicy == nullptr) {
+        return;
+    }
+    update_memory_statistics(-1);
+    legalMoves.reserve(numberChildNodes);
+    fill_child_node_moves(pos);
+    assert(legalMoves.size() == numberChildNodes);
+    sort(legalMoves.begin(), legalMoves.end());
+    policyProbSmall.resize(numberChildNodes);
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        policyProbSmall[idx] = half_to_float(compactPolicy[idx]);
+    }
+    compactPolicy.reset();
+    update_memory_statistics(1);
+}
+
+bool Node::is_compressed() const
+{
+    return compactPolicy != nullptr;
+}
+
+void Node::generate_deferred_moves(Board* pos)
+{
+    if (!deferredMoves) {
+        return;
+    }
+    update_memory_statistics(-1);
+    fill_child_node_moves(pos);
+    numberChildNodes = legalMoves.size();
+    policyProbSmall.resize(numberChildNodes);
+    deferredMoves = false;
+    update_memory_statistics(1);
+    if (isTerminal) {
+        // a drawn leaf can become the root node if the game continues, so its node data is resized for all moves
+        const NodeType nodeType = d->nodeType;
+        init_node_data();
+        d->nodeType = nodeType;
+        return;
+    }
+    if (numberChildNodes == 0) {
+        // a checkmate or stalemate isn't a tablebase position
+        isTablebase = false;
+        mark_as_mate_or_stalemate(pos, pos->checkers());
+    }
+}
+
+bool Node::has_deferred_moves() const
+{
+    return deferredMoves;
+}
+
+void Node::truncate_policy(float policyMassThreshold)
+{
+    if (policyMassThreshold >= 1.0f || is_root_node() || numberTailMoves != 0) {
+        return;
+    }
+    size_t numberKeptMoves = 0;
+    float policyMass = 0;
+    while (numberKeptMoves < numberChildNodes && policyMass < policyMassThreshold) {
+        policyMass += policyProbSmall[numberKeptMoves++];
+    }
+    numberKeptMoves = max(numberKeptMoves, min(size_t(PRESERVED_ITEMS), size_t(numberChildNodes)));
+    if (numberKeptMoves == numberChildNodes) {
+        return;
+    }
+    update_memory_statistics(-1);
+    tailPolicyMass = sum(blaze::subvector(policyProbSmall, numberKeptMoves, numberChildNodes - numberKeptMoves));
+    numberTailMoves = numberChildNodes - numberKeptMoves;
+    numberChildNodes = numberKeptMoves;
+    legalMoves.resize(numberChildNodes);
+    legalMoves.shrink_to_fit();
+    policyProbSmall.resize(numberChildNodes);
+    policyProbSmall.shrinkToFit();
+    update_memory_statistics(1);
+}
+
+void Node::expand_policy_tail(Board* pos)
+{
+    if (numberTailMoves == 0) {
+        return;
+    }
+    update_memory_statistics(-1);
+    vector<Move> keptMoves = legalMoves;
+    sort(keptMoves.begin(), keptMoves.end());
+    legalMoves.reserve(numberChildNodes + numberTailMoves);
+    for (const ExtMove& move : MoveList<LEGAL>(*pos)) {
+        if (!binary_search(keptMoves.begin(), keptMoves.end(), Move(move))) {
+            legalMoves.push_back(move);
+        }
+    }
+    assert(legalMoves.size() == size_t(numberChildNodes + numberTailMoves));
+    // the order by prior remains valid because the average of the tail is at most the smallest kept prior
+    policyProbSmall.resize(legalMoves.size());
+    for (size_t idx = numberChildNodes; idx < legalMoves.size(); ++idx) {
+        policyProbSmall[idx] = tailPolicyMass / numberTailMoves;
+    }
+    numberChildNodes = legalMoves.size();
+    numberTailMoves = 0;
+    tailPolicyMass = 0;
+    update_memory_statistics(1);
 }
 
 float Node::get_visits() const
@@ -554,6 +825,11 @@ float Node::get_terminal_visits() const
     return d->terminalVisits;
 }
 
+uint16_t Node::get_number_unsolved_child_nodes() const
+{
+    return d->numberUnsolvedChildNodes;
+}
+
 void Node::init_node_data(size_t numberNodes)
 {
     d = make_unique<NodeData>(numberNodes);
@@ -572,22 +848,8 @@ void Node::mark_as_terminal()
 
 void Node::check_for_terminal(Board* pos, bool inCheck)
 {
-    if (get_number_child_nodes() == 0) {
-        mark_as_terminal();
-#ifdef ANTI
-        if (pos->is_anti()) {
-            // a stalmate is a win in antichess
-            set_value(WIN);
-            return;
-        }
-#endif
-        // test if we have a check-mate
-        if (inCheck) {
-            mark_as_loss();
-            return;
-        }
-        // we reached a stalmate
-        mark_as_draw();
+    if (!deferredMoves && get_number_child_nodes() == 0) {
+        mark_as_mate_or_stalemate(pos, inCheck);
         return;
     }
 #ifdef ANTI
@@ -615,6 +877,28 @@ void Node::check_for_terminal(Board* pos, bool inCheck)
     //    isTerminal = false;  // is the default value
 }
 
+void Node::mark_as_mate_or_stalemate(Board* pos, bool inCheck)
+{
+    init_node_data();
+#ifdef ANTI
+    if (pos->is_anti()) {
+        // a stalmate is a win in antichess
+        set_value(WIN);
+    }
+    else
+#endif
+    if (inCheck) {
+        // we have a check-mate
+        mark_as_loss();
+    }
+    else {
+        // we reached a stalmate
+        mark_as_draw();
+    }
+    // the flag is set last, because a leaf with deferred moves can already be reached by other threads
+    isTerminal = true;
+}
+
 void Node::check_for_tablebase_wdl(Board *pos)
 {
     Tablebases::ProbeState result;
@@ -643,7 +927,11 @@ void Node::make_to_root()
 
 void Node::lock()
 {
+#ifdef LOCK_PROFILING
+    profiled_lock(mtx, get_lock_class());
+#else
     mtx.lock();
+#endif
 }
 
 void Node::unlock()
@@ -826,10 +1114,17 @@ size_t get_best_move_index(const Node *curNode)
     return argmax(mctsPolicy);
 }
 
-size_t Node::select_child_node(const SearchSettings* searchSettings)
+size_t Node::select_child_node(const SearchSettings* searchSettings, Board* pos)
 {
     if (!sorted) { //visits == 1) {
+        restore_moves_and_policy(pos);
         prepare_node_for_visits();
+        truncate_policy(searchSettings->policyMassThreshold);
+    }
+    if (numberTailMoves != 0 && d->noVisitIdx == numberChildNodes && d->childNodes[numberChildNodes-1] != nullptr) {
+        // all stored moves have been expanded, so the truncated moves are needed again
+        expand_policy_tail(pos);
+        add_unvisited_child();
     }
     if (searchSettings->useRandomPlayout) {
         if (is_root_node() && random() % 20 == 0) {
@@ -853,7 +1148,22 @@ size_t Node::select_child_node(const SearchSettings* searchSettings)
     // find the move according to the q- and u-values for each move
     // calculate the current u values
     // it's not worth to save the u values as a node attribute because u is updated every time n_sum changes
-    return argmax(d->qValues + get_current_u_values(searchSettings));
+    const DynamicVector<float> scores = d->qValues + get_current_u_values(searchSettings);
+    size_t bestIdx = 0;
+    size_t runnerUpIdx = 0;
+    for (size_t idx = 1; idx < scores.size(); ++idx) {
+        if (scores[idx] > scores[bestIdx]) {
+            runnerUpIdx = bestIdx;
+            bestIdx = idx;
+        }
+        else if (runnerUpIdx == bestIdx || scores[idx] > scores[runnerUpIdx]) {
+            runnerUpIdx = idx;
+        }
+    }
+    if (runnerUpIdx != bestIdx && d->childNodes[runnerUpIdx] != nullptr) {
+        prefetch(d->childNodes[runnerUpIdx]);
+    }
+    return bestIdx;
 }
 
 const char* node_type_to_string(enum NodeType nodeType)
@@ -932,7 +1242,7 @@ void generate_dtz_values(const vector<Move> legalMoves, Board& pos, DynamicVecto
     }
 }
 
-void delete_sibling_subtrees(Node* node, unordered_map<Key, Node*>& hashTable)
+void delete_sibling_subtrees(Node* node, HashTable& hashTable)
 {
     if (node->get_parent_node() != nullptr) {
         info_string("delete unused subtrees");
@@ -944,7 +1254,15 @@ void delete_sibling_subtrees(Node* node, unordered_map<Key, Node*>& hashTable)
     }
 }
 
-void delete_subtree_and_hash_entries(Node* node, unordered_map<Key, Node*>& hashTable)
+void replace_hash_entry(HashTable& hashTable, const Node* oldNode, Node* newNode)
+{
+    auto it = hashTable.find(newNode->hash_key());
+    if (it != hashTable.end() && it->second == oldNode) {
+        it->second = newNode;
+    }
+}
+
+void delete_subtree_and_hash_entries(Node* node, HashTable& hashTable)
 {
     if (node == nullptr) {
         return;
@@ -959,6 +1277,7 @@ void delete_subtree_and_hash_entries(Node* node, unordered_map<Key, Node*>& hash
     auto it = hashTable.find(node->hash_key());
     if(it != hashTable.end()) {
         hashTable.erase(node->hash_key());
+        memoryStatistics.add(MEM_HASH_TABLE, -int64_t(hash_table_entry_bytes<HashTable>()));
     }
     delete node;
 }
@@ -40,11 +40,16 @@
 #include "agents/config/searchsettings.h"
 #include "nodedata.h"
 #include "constants.h"
+#include "util/lockstatistics.h"
+#include "util/hugepages.h"
 
 using blaze::HybridVector;
 using blaze::DynamicVector;
 using namespace std;
 
+// hash table of all nodes in the tree, its entries and buckets are allocated by the tree allocator
+typedef unordered_map<Key, Node*, hash<Key>, equal_to<Key>, TreeAllocator<pair<const Key, Node*>>> HashTable;
+
 class Node
 {
 private:
@@ -52,6 +57,8 @@ private:
 
     DynamicVector<float> policyProbSmall;
     vector<Move> legalMoves;
+    // prior policy in half precision for leaf nodes whose moves have been released (see compress_policy())
+    unique_ptr<uint16_t[]> compactPolicy;
     //    DynamicVector<bool> isCheck;
     //    DynamicVector<bool> isCapture;
 
@@ -60,9 +67,14 @@ private:
 
     // singular values
     float value;
+    // summed prior of the moves which have been cut off by truncate_policy()
+    float tailPolicyMass;
     unique_ptr<NodeData> d;
 
     uint16_t childIdxForParent;
+    uint16_t numberChildNodes;
+    // number of legal moves which are currently not stored (see truncate_policy())
+    uint16_t numberTailMoves;
     // identifiers
     uint16_t pliesFromNull;
 
@@ -70,6 +82,8 @@ private:
     bool isTablebase;
     bool hasNNResults;
     bool sorted;
+    // the legal moves of a new leaf are generated when its NN results are assigned (see generate_deferred_moves())
+    bool deferredMoves;
 
 public:
     /**
@@ -91,11 +105,57 @@ public:
      */
     Node(const Node& b);
 
+    /**
+     * @brief Node Move constructor which takes over all statistics including the node data and the child nodes.
+     * The parent and child nodes aren't updated (see relocate_child_nodes()).
+     * @param b Node which will only be destroyed afterwards
+     */
+    Node(Node&& b);
+
     /**
      * @brief ~Node Destructor which frees memory and the board position
      */
     ~Node();
 
+    /**
+     * @brief operator new Allocates a single node outside of a child block (e.g. the root node)
+     */
+    static void* operator new(size_t bytes);
+
+    /**
+     * @brief operator new Constructs a node in the memory which was returned by allocate_child_memory()
+     */
+    static void* operator new(size_t bytes, void* memory) {
+        (void)bytes;
+        return memory;
+    }
+
+    /**
+     * @brief operator delete Frees a single node or releases the child block which contains the node
+     */
+    static void operator delete(void* ptr, size_t bytes);
+    static void operator delete(void* ptr, void* memory) {
+        (void)ptr;
+        (void)memory;
+    }
+
+    /**
+     * @brief allocate_child_memory Returns memory for the child node at the given index from the child blocks of this node,
+     * so that sibling nodes are stored next to each other. The node must be constructed by placement new.
+     * @param childIdx Child index
+     * @return Memory for the child node or nullptr if the slot is already in use (the node must be allocated by new Node() then)
+     */
+    void* allocate_child_memory(size_t childIdx);
+
+    /**
+     * @brief relocate_child_nodes Copies the policy, the moves and the node data of this node into newly allocated memory,
+     * moves all child nodes into new child blocks and updates the parent pointers, the child pointers and the hash table entries.
+     * Must not be called during the search.
+     * @param hashTable Hash table of the tree
+     * @param relocatedNodes The relocated child nodes are appended to this list
+     */
+    void relocate_child_nodes(HashTable& hashTable, vector<Node*>& relocatedNodes);
+
     /**
      * @brief get_current_u_values Calucates and returns the current u-values for this node
      * @return DynamicVector<float>
@@ -110,7 +170,12 @@ public:
      */
     Node* get_child_node(size_t childIdx);
 
-    size_t select_child_node(const SearchSettings* searchSettings);
+    /**
+     * @brief select_child_node Returns the child index with the highest Q+U value.
+     * The runner-up child is prefetched because the next rollout of the mini-batch is likely to visit it due to the virtual loss.
+     * @param pos Board position of this node, which is needed to restore the moves of a compressed node on its second visit
+     */
+    size_t select_child_node(const SearchSettings* searchSettings, Board* pos);
 
     /**
      * @brief backup_value Iteratively backpropagates a value prediction across all of the parents for this node.
@@ -160,6 +225,49 @@ public:
 
     void prepare_node_for_visits();
 
+    /**
+     * @brief compress_policy Stores the prior policy of a new leaf node in half precision and frees its legal moves and policy vector.
+     * This reduces the memory per legal move from sizeof(Move) + sizeof(float) plus the padding of the policy vector to 2 bytes.
+     * The policy is stored in the order of the move encoding, because the move generation order depends on the move history.
+     * Does nothing for root nodes, terminal nodes and nodes which have already been prepared for visits.
+     * Must be called before the node is marked as having NN results, because other threads can visit it afterwards.
+     */
+    void compress_policy();
+
+    /**
+     * @brief restore_moves_and_policy Regenerates the legal moves of a compressed node and expands its prior policy to single precision.
+     * Does nothing if the node isn't compressed.
+     * @param pos Board position of this node
+     */
+    void restore_moves_and_policy(Board* pos);
+
+    bool is_compressed() const;
+
+    /**
+     * @brief generate_deferred_moves Generates the legal moves of a new leaf node whose move generation has been skipped by the constructor
+     * (see SearchSettings::compactLeafNodes) and marks it as a checkmate or stalemate if there are none.
+     * Does nothing if the moves have already been generated. Terminal leaves keep their deferred moves until they become the root node.
+     * Must be called before the node is marked as having NN results, because other threads can visit it afterwards.
+     * @param pos Board position of this node
+     */
+    void generate_deferred_moves(Board* pos);
+
+    bool has_deferred_moves() const;
+
+    /**
+     * @brief truncate_policy Keeps only the moves with the highest priors which cover the given policy mass (at least PRESERVED_ITEMS moves)
+     * and frees the remaining moves. Their summed prior is kept and distributed uniformly when they are needed again.
+     * The moves must be sorted by their prior already. Root nodes aren't truncated.
+     * @param policyMassThreshold Policy mass which is covered by the stored moves (1.0: no truncation)
+     */
+    void truncate_policy(float policyMassThreshold);
+
+    /**
+     * @brief expand_policy_tail Regenerates the moves which have been cut off by truncate_policy() and appends them with a uniform prior
+     * @param pos Board position of this node
+     */
+    void expand_policy_tail(Board* pos);
+
     /**
      * @brief sort_nodes_by_probabilities Sorts all child nodes in ascending order based on their probability value
      */
@@ -277,6 +385,12 @@ public:
      */
     bool is_root_node() const;
 
+    /**
+     * @brief get_lock_class Returns the lock class of this node which is used for lock profiling (root, depth 1-2 or deeper)
+     * @return LockClass
+     */
+    LockClass get_lock_class() const;
+
     /**
      * @brief operator << Overload of stdout operator. Prints move, number visits, probability Value and Q-value
      * @param os ostream handle
@@ -291,6 +405,7 @@ public:
     uint8_t get_node_type() const;
     uint16_t get_end_in_ply() const;
     float get_terminal_visits() const;
+    uint16_t get_number_unsolved_child_nodes() const;
 
     void init_node_data(size_t numberNodes);
     void init_node_data();
@@ -300,11 +415,21 @@ public:
     bool is_sorted() const;
 
 private:
+    /**
+     * @brief update_memory_statistics Adds (sign=1) or removes (sign=-1) the memory of this node and its move and policy vectors from the memory statistics
+     */
+    void update_memory_statistics(int64_t sign) const;
+
     /**
      * @brief reserve_full_memory Reserves memory for all available child nodes
      */
     void reserve_full_memory();
 
+    /**
+     * @brief add_unvisited_child Makes the next unvisited child available for selection. The node must be locked by the caller.
+     */
+    void add_unvisited_child();
+
     /**
      * @brief check_for_terminal Checks if the given board position is a terminal node and updates isTerminal
      * @param pos Current board position for this node
@@ -312,6 +437,13 @@ private:
      */
     void check_for_terminal(Board* pos, bool inCheck);
 
+    /**
+     * @brief mark_as_mate_or_stalemate Marks a node without legal moves as terminal and sets its value
+     * @param pos Current board position for this node
+     * @param inCheck Boolean indicating if the king is in check
+     */
+    void mark_as_mate_or_stalemate(Board* pos, bool inCheck);
+
     /**
      * @brief check_for_tablebase_wdl Checks if the given board position is a tablebase position and
      *  updates isTerminal and the value evaluation
@@ -464,13 +596,22 @@ inline bool enhance_move_type(float increment, float thresh, const vector<Move>&
  * @param node Node of the subtree to delete
  * @param hashTable Pointer to the hashTable which stores a pointer to all active nodes
  */
-void delete_subtree_and_hash_entries(Node *node, unordered_map<Key, Node*>& hashTable);
+void delete_subtree_and_hash_entries(Node *node, HashTable& hashTable);
 
 /**
  * @brief delete_sibling_subtrees Deletes all subtrees from all simbling nodes, deletes their hash table entry and sets the visit access to nullptr
  * @param hashTable Pointer to the hashTables
  */
-void delete_sibling_subtrees(Node* node, unordered_map<Key, Node*>& hashTable);
+void delete_sibling_subtrees(Node* node, HashTable& hashTable);
+
+/**
+ * @brief replace_hash_entry Lets the hash table entry of the given node point to its new location
+ * if the node is the one which is stored in the hash table
+ * @param hashTable Hash table of the tree
+ * @param oldNode Former location of the node
+ * @param newNode New location of the node
+ */
+void replace_hash_entry(HashTable& hashTable, const Node* oldNode, Node* newNode);
 
 typedef float (* vFunctionValue)(Node* node);
 DynamicVector<float> retrieve_dynamic_vector(const vector<Node*>& childNodes, vFunctionValue func);
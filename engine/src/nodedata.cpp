@@ -24,7 +24,9 @@
  */
 
 #include "nodedata.h"
+#include <algorithm>
 #include "util/blazeutil.h"
+#include "util/memorystatistics.h"
 
 void NodeData::add_empty_node()
 {
@@ -55,6 +57,7 @@ void NodeData::reserve_initial_space()
 }
 
 NodeData::NodeData(size_t numberChildNodes):
+    childBlocks{},
     visits(1),
     terminalVisits(0),
     checkmateIdx(NO_CHECKMATE),
@@ -67,6 +70,46 @@ NodeData::NodeData(size_t numberChildNodes):
     numberUnsolvedChildNodes = numberChildNodes;
 
     reserve_initial_space();
+    memoryStatistics.add(MEM_NODE_DATA, sizeof(NodeData) + dynamic_memory());
+}
+
+NodeData::NodeData(const NodeData& b, size_t reservedChildNodes):
+    childBlocks{},
+    visits(b.visits),
+    terminalVisits(b.terminalVisits),
+    checkmateIdx(b.checkmateIdx),
+    endInPly(b.endInPly),
+    noVisitIdx(b.noVisitIdx),
+    numberUnsolvedChildNodes(b.numberUnsolvedChildNodes),
+    nodeType(b.nodeType)
+{
+    // the memory is reserved first, so that appending the next unvisited child nodes doesn't reallocate the vectors
+    reservedChildNodes = max(reservedChildNodes, b.childNodes.size());
+    childNumberVisits.reserve(reservedChildNodes);
+    actionValues.reserve(reservedChildNodes);
+    qValues.reserve(reservedChildNodes);
+    childNodes.reserve(reservedChildNodes);
+    childNumberVisits = b.childNumberVisits;
+    actionValues = b.actionValues;
+    qValues = b.qValues;
+    childNodes.assign(b.childNodes.begin(), b.childNodes.end());
+    memoryStatistics.add(MEM_NODE_DATA, sizeof(NodeData) + dynamic_memory());
+}
+
+NodeData::~NodeData()
+{
+    for (ChildBlock* childBlock : childBlocks) {
+        if (childBlock != nullptr) {
+            childBlock->release();
+        }
+    }
+    memoryStatistics.add(MEM_NODE_DATA, -int64_t(sizeof(NodeData) + dynamic_memory()));
+}
+
+size_t NodeData::dynamic_memory() const
+{
+    return (childNumberVisits.capacity() + actionValues.capacity() + qValues.capacity()) * sizeof(float) +
+            childNodes.capacity() * sizeof(Node*);
 }
 
 auto NodeData::get_q_values()
@@ -74,3 +117,47 @@ auto NodeData::get_q_values()
     return blaze::subvector(qValues, 0, noVisitIdx);
 }
 
+
+// the header and the used flags are padded, so that every slot is aligned like the block itself
+inline size_t child_block_header_bytes(size_t capacity)
+{
+    return (sizeof(ChildBlock) + capacity + NODE_PREFIX_BYTES - 1) / NODE_PREFIX_BYTES * NODE_PREFIX_BYTES;
+}
+
+ChildBlock* ChildBlock::create(size_t firstChildIdx, size_t capacity, size_t nodeBytes)
+{
+    const size_t slotBytes = (NODE_PREFIX_BYTES + nodeBytes + NODE_PREFIX_BYTES - 1) / NODE_PREFIX_BYTES * NODE_PREFIX_BYTES;
+    const size_t bytes = child_block_header_bytes(capacity) + capacity * slotBytes;
+    ChildBlock* block = static_cast<ChildBlock*>(allocate_tree_memory(bytes));
+    new (&block->references) atomic<uint32_t>(1);
+    block->firstChildIdx = firstChildIdx;
+    block->capacity = capacity;
+    block->slotBytes = slotBytes;
+    block->bytes = bytes;
+    uint8_t* usedFlags = reinterpret_cast<uint8_t*>(block + 1);
+    fill(usedFlags, usedFlags + capacity, 0);
+    memoryStatistics.add(MEM_NODE, bytes);
+    return block;
+}
+
+void* ChildBlock::claim_slot(size_t childIdx)
+{
+    const size_t slotIdx = childIdx - firstChildIdx;
+    uint8_t* usedFlags = reinterpret_cast<uint8_t*>(this + 1);
+    if (slotIdx >= capacity || usedFlags[slotIdx]) {
+        return nullptr;
+    }
+    usedFlags[slotIdx] = 1;
+    references.fetch_add(1, memory_order_relaxed);
+    char* slot = reinterpret_cast<char*>(this) + child_block_header_bytes(capacity) + slotIdx * slotBytes;
+    *reinterpret_cast<ChildBlock**>(slot) = this;
+    return slot + NODE_PREFIX_BYTES;
+}
+
+void ChildBlock::release()
+{
+    if (references.fetch_sub(1, memory_order_acq_rel) == 1) {
+        memoryStatistics.add(MEM_NODE, -int64_t(bytes));
+        deallocate_tree_memory(this, bytes);
+    }
+}
@@ -28,6 +28,7 @@
 #ifndef NODEDATA_H
 #define NODEDATA_H
 
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <unordered_map>
@@ -39,6 +40,7 @@
 
 #include "agents/config/searchsettings.h"
 #include "constants.h"
+#include "util/hugepages.h"
 
 using blaze::HybridVector;
 using blaze::DynamicVector;
@@ -54,6 +56,70 @@ enum NodeType : uint8_t {
 
 class Node;
 
+// every node in a child block is preceded by a pointer to the block header (16 bytes to keep the alignment)
+constexpr size_t NODE_PREFIX_BYTES = 16;
+
+// number of child blocks per node: the first one holds PRESERVED_ITEMS child nodes, the size doubles with every further block
+// and the last block holds all remaining child nodes (e.g. children [0,8), [8,16), [16,32) and [32,end))
+constexpr size_t NB_CHILD_BLOCKS = 4;
+
+/**
+ * @brief child_block_begin Returns the child index of the first slot of the given child block
+ */
+inline size_t child_block_begin(size_t blockIdx)
+{
+    return blockIdx == 0 ? 0 : size_t(PRESERVED_ITEMS) << (blockIdx - 1);
+}
+
+/**
+ * @brief child_block_index Returns the index of the child block which stores the given child node
+ */
+inline size_t child_block_index(size_t childIdx)
+{
+    size_t blockIdx = 0;
+    while (blockIdx + 1 < NB_CHILD_BLOCKS && childIdx >= child_block_begin(blockIdx + 1)) {
+        ++blockIdx;
+    }
+    return blockIdx;
+}
+
+/**
+ * @brief The ChildBlock struct is the header of a memory block which stores several sibling nodes next to each other.
+ * The header is followed by a used flag for each slot and the slots themselves.
+ * The block is referenced by the node data of the parent and by every node which has been constructed in it.
+ * It is freed when the last reference has been released, so a subtree which is kept for tree reuse stays valid.
+ */
+struct ChildBlock
+{
+    atomic<uint32_t> references;
+    uint16_t firstChildIdx;
+    uint16_t capacity;
+    uint32_t slotBytes;
+    uint32_t bytes;
+
+    /**
+     * @brief create Allocates a new child block which is referenced by the caller
+     * @param firstChildIdx Child index of the first slot
+     * @param capacity Number of slots
+     * @param nodeBytes Size of a single node
+     * @return Pointer to the header
+     */
+    static ChildBlock* create(size_t firstChildIdx, size_t capacity, size_t nodeBytes);
+
+    /**
+     * @brief claim_slot Reserves the slot of the given child and adds a reference for the node which will be constructed in it.
+     * Expects the parent node to be locked.
+     * @param childIdx Child index
+     * @return Memory for the node or nullptr if the slot has already been claimed
+     */
+    void* claim_slot(size_t childIdx);
+
+    /**
+     * @brief release Removes a reference and frees the block if it was the last one
+     */
+    void release();
+};
+
 /**
  * @brief The NodeData struct stores the member variables for all expanded child nodes which have at least been visited two times
  */
@@ -63,6 +129,8 @@ struct NodeData
     DynamicVector<float> actionValues;
     DynamicVector<float> qValues;
     vector<Node*> childNodes;
+    // memory of the child nodes, the blocks are allocated when their first child node is created
+    ChildBlock* childBlocks[NB_CHILD_BLOCKS];
 
     float visits;
     float terminalVisits;
@@ -74,9 +142,30 @@ struct NodeData
 
     NodeType nodeType;
     NodeData(size_t numberChildNodes);
+    /**
+     * @brief NodeData Copies the statistics and the child node pointers into newly allocated vectors.
+     * The child blocks aren't copied and stay with b.
+     * @param b Node data to copy
+     * @param reservedChildNodes Number of child nodes for which the vectors reserve memory (at least their current size)
+     */
+    NodeData(const NodeData& b, size_t reservedChildNodes);
+    ~NodeData();
+
+    static void* operator new(size_t bytes) {
+        return allocate_tree_memory(bytes);
+    }
+    static void operator delete(void* ptr, size_t bytes) {
+        deallocate_tree_memory(ptr, bytes);
+    }
 
     auto get_q_values();
 
+    /**
+     * @brief dynamic_memory Returns the number of bytes which are currently reserved by the child node vectors
+     * @return size_t
+     */
+    size_t dynamic_memory() const;
+
 public:
     /**
      * @brief add_empty_node Adds a new empty node to its child nodes
@@ -28,6 +28,7 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include "util/tracer.h"
 
 using namespace std;
 
@@ -35,6 +36,10 @@ void on_logger(const Option& o) {
     start_logger(o);
 }
 
+void on_tracer(const Option& o) {
+    tracer.set_file(string(o));
+}
+
 void OptionsUCI::init(OptionsMap &o)
 {
 #ifdef MODE_CRAZYHOUSE
@@ -99,6 +104,22 @@ void OptionsUCI::init(OptionsMap &o)
     o["Centi_Resign_Probability"]      << Option(90, 0, 100);
     o["Centi_Resign_Threshold"]        << Option(-90, -100, 100);
     o["Reuse_Tree"]                    << Option(false);
+    o["Selfplay_Concurrent_Games"]     << Option(1, 1, 512);
+    o["Selfplay_Batch_Timeout_us"]     << Option(2000, 0, 1000000);
+    o["Selfplay_Compact_Export"]       << Option(false);
+    o["Selfplay_Multi_Writer"]         << Option(false);
+    o["Selfplay_Compress_PGN"]         << Option(false);
+    o["Selfplay_Metrics_Interval_s"]   << Option(60, 0, 99999);
+    o["Selfplay_Opening_Pool_Size"]    << Option(0, 0, 99999);
+    o["Selfplay_Adjudicate_Tablebase"] << Option(false);
+    o["Centi_Draw_Q_Threshold"]        << Option(5, 0, 100);
+    o["Draw_Adjudication_Plies"]       << Option(0, 0, 99999);
+    o["Selfplay_Max_Plies"]            << Option(0, 0, 99999);
+    o["Arena_SPRT"]                    << Option(false);
+    o["Arena_SPRT_Elo0"]               << Option(0, -1000, 1000);
+    o["Arena_SPRT_Elo1"]               << Option(10, -1000, 1000);
+    o["Centi_Arena_SPRT_Alpha"]        << Option(5, 1, 49);
+    o["Centi_Arena_SPRT_Beta"]         << Option(5, 1, 49);
 #endif
     o["Move_Overhead"]                 << Option(50, 0, 5000);
     o["Centi_Random_Move_Factor"]      << Option(0, 0, 99);
@@ -106,6 +127,14 @@ void OptionsUCI::init(OptionsMap &o)
     o["Use_Solver"]                    << Option(true);
     o["Log_File"]                      << Option("", on_logger);
     o["Use_NPS_Time_Manager"]          << Option(true);
+    o["Log_Search_Statistics"]         << Option(false);
+    o["Trace_File"]                    << Option("", on_tracer);
+    o["Thread_Affinity"]               << Option("none", {"none", "numa_local", "numa_remote"});
+    o["Search_Cores"]                  << Option(0, -1, 512);
+    o["Use_Huge_Pages"]                << Option(false);
+    o["Compact_Tree"]                  << Option(false);
+    o["Compact_Leaf_Nodes"]            << Option(false);
+    o["Milli_Policy_Mass_Threshold"]   << Option(1000, 1, 1000);
 #ifdef SUPPORT960
     o["UCI_Chess960"]                  << Option(true);
 #endif
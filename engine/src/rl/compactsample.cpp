@@ -0,0 +1,270 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: compactsample.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "compactsample.h"
+#include <cstring>
+#include <algorithm>
+#include "../domain/crazyhouse/constants.h"
+
+const char COMPACT_MAGIC[4] = {'C', 'A', 'C', 'S'};
+const uint32_t COMPACT_VERSION = 1;
+const size_t NB_PLANE_KIND_BYTES = (NB_CHANNELS_TOTAL + 3) / 4;
+// plane kinds, value, bestMoveQ and the number of policy entries
+const size_t MIN_SAMPLE_BYTES = NB_PLANE_KIND_BYTES + sizeof(int16_t) + sizeof(float) + sizeof(uint16_t);
+
+template<typename T>
+inline void append(vector<uint8_t>& buffer, T value)
+{
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+inline T read(const uint8_t*& data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+}
+
+inline bool has_bytes(const uint8_t* data, const uint8_t* end, size_t numberBytes)
+{
+    return size_t(end - data) >= numberBytes;
+}
+
+size_t plane_bytes(PlaneKind kind)
+{
+    switch (kind) {
+    case PLANE_SCALAR:
+        return sizeof(int16_t);
+    case PLANE_BITBOARD:
+        return sizeof(uint64_t);
+    case PLANE_DENSE:
+        return NB_SQUARES * sizeof(int16_t);
+    default:
+        return 0;
+    }
+}
+
+PlaneKind get_plane_kind(const int16_t* plane)
+{
+    bool isConstant = true;
+    bool isBinary = true;
+    for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+        isConstant &= plane[idx] == plane[0];
+        isBinary &= plane[idx] == 0 || plane[idx] == 1;
+    }
+    if (isConstant) {
+        return plane[0] == 0 ? PLANE_EMPTY : PLANE_SCALAR;
+    }
+    return isBinary ? PLANE_BITBOARD : PLANE_DENSE;
+}
+
+void encode_compact_sample(const int16_t* planes, const float* policy, int16_t value, float bestMoveQ, vector<uint8_t>& buffer)
+{
+    // the plane kinds are stored with 2 bits each in front of the plane data
+    const size_t kindOffset = buffer.size();
+    buffer.resize(kindOffset + NB_PLANE_KIND_BYTES, 0);
+    for (size_t channel = 0; channel < NB_CHANNELS_TOTAL; ++channel) {
+        const int16_t* plane = planes + channel * NB_SQUARES;
+        const PlaneKind kind = get_plane_kind(plane);
+        buffer[kindOffset + channel / 4] |= kind << (2 * (channel % 4));
+        switch (kind) {
+        case PLANE_EMPTY:
+            break;
+        case PLANE_SCALAR:
+            append(buffer, plane[0]);
+            break;
+        case PLANE_BITBOARD: {
+            uint64_t bitboard = 0;
+            for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+                bitboard |= uint64_t(plane[idx]) << idx;
+            }
+            append(buffer, bitboard);
+            break;
+        }
+        case PLANE_DENSE:
+            for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+                append(buffer, plane[idx]);
+            }
+        }
+    }
+    append(buffer, value);
+    append(buffer, bestMoveQ);
+
+    // sparse policy
+    const size_t numberMovesOffset = buffer.size();
+    append(buffer, uint16_t(0));
+    uint16_t numberMoves = 0;
+    for (size_t idx = 0; idx < NB_LABELS; ++idx) {
+        if (policy[idx] != 0) {
+            append(buffer, uint16_t(idx));
+            append(buffer, policy[idx]);
+            ++numberMoves;
+        }
+    }
+    memcpy(buffer.data() + numberMovesOffset, &numberMoves, sizeof(uint16_t));
+}
+
+size_t decode_compact_sample(const uint8_t* data, const uint8_t* end, int16_t* planes, float* policy, int16_t& value, float& bestMoveQ)
+{
+    const uint8_t* start = data;
+    const uint8_t* kinds = data;
+    if (!has_bytes(data, end, NB_PLANE_KIND_BYTES)) {
+        return 0;
+    }
+    data += NB_PLANE_KIND_BYTES;
+    for (size_t channel = 0; channel < NB_CHANNELS_TOTAL; ++channel) {
+        int16_t* plane = planes + channel * NB_SQUARES;
+        const PlaneKind kind = PlaneKind((kinds[channel / 4] >> (2 * (channel % 4))) & 3);
+        if (!has_bytes(data, end, plane_bytes(kind))) {
+            return 0;
+        }
+        switch (kind) {
+        case PLANE_EMPTY:
+            fill(plane, plane + NB_SQUARES, 0);
+            break;
+        case PLANE_SCALAR:
+            fill(plane, plane + NB_SQUARES, read<int16_t>(data));
+            break;
+        case PLANE_BITBOARD: {
+            const uint64_t bitboard = read<uint64_t>(data);
+            for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+                plane[idx] = int16_t((bitboard >> idx) & 1);
+            }
+            break;
+        }
+        case PLANE_DENSE:
+            for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+                plane[idx] = read<int16_t>(data);
+            }
+        }
+    }
+    if (!has_bytes(data, end, sizeof(int16_t) + sizeof(float) + sizeof(uint16_t))) {
+        return 0;
+    }
+    value = read<int16_t>(data);
+    bestMoveQ = read<float>(data);
+
+    fill(policy, policy + NB_LABELS, 0.0f);
+    const uint16_t numberMoves = read<uint16_t>(data);
+    if (!has_bytes(data, end, numberMoves * (sizeof(uint16_t) + sizeof(float)))) {
+        return 0;
+    }
+    for (uint16_t moveIdx = 0; moveIdx < numberMoves; ++moveIdx) {
+        const uint16_t policyIdx = read<uint16_t>(data);
+        if (policyIdx >= NB_LABELS) {
+            return 0;
+        }
+        policy[policyIdx] = read<float>(data);
+    }
+    return size_t(data - start);
+}
+
+size_t dense_sample_bytes()
+{
+    // x, y_policy, y_value and y_best_move_q (the start indices are stored once per game)
+    return NB_VALUES_TOTAL * sizeof(int16_t) + NB_LABELS * sizeof(float) + sizeof(int16_t) + sizeof(float);
+}
+
+void write_compact_header(ostream& out)
+{
+    const uint32_t dimensions[3] = {COMPACT_VERSION, uint32_t(NB_CHANNELS_TOTAL), uint32_t(NB_LABELS)};
+    out.write(COMPACT_MAGIC, sizeof(COMPACT_MAGIC));
+    out.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+}
+
+bool read_compact_header(istream& in)
+{
+    char magic[4];
+    uint32_t dimensions[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions));
+    return in.good() && equal(magic, magic + 4, COMPACT_MAGIC) && dimensions[0] == COMPACT_VERSION &&
+            dimensions[1] == uint32_t(NB_CHANNELS_TOTAL) && dimensions[2] == uint32_t(NB_LABELS);
+}
+
+void write_compact_game(ostream& out, const vector<uint8_t>& encodedSamples, uint32_t numberSamples)
+{
+    const uint32_t numberBytes = uint32_t(encodedSamples.size());
+    out.write(reinterpret_cast<const char*>(&numberSamples), sizeof(numberSamples));
+    out.write(reinterpret_cast<const char*>(&numberBytes), sizeof(numberBytes));
+    out.write(reinterpret_cast<const char*>(encodedSamples.data()), numberBytes);
+}
+
+// returns the number of bytes after the current position or SIZE_MAX if the stream isn't seekable
+size_t remaining_bytes(istream& in)
+{
+    const istream::pos_type position = in.tellg();
+    if (position == istream::pos_type(-1)) {
+        return SIZE_MAX;
+    }
+    in.seekg(0, ios::end);
+    const istream::pos_type endPosition = in.tellg();
+    in.seekg(position);
+    return size_t(endPosition - position);
+}
+
+CompactReadStatus read_compact_game(istream& in, DecodedGame& game)
+{
+    uint32_t lengths[2];
+    in.read(reinterpret_cast<char*>(lengths), sizeof(lengths));
+    if (in.gcount() == 0) {
+        return COMPACT_END_OF_FILE;
+    }
+    if (!in.good()) {
+        return COMPACT_CORRUPT;
+    }
+    const uint32_t numberSamples = lengths[0];
+    const uint32_t numberBytes = lengths[1];
+    // the sizes are checked before any memory is allocated for them
+    if (numberBytes > remaining_bytes(in) || numberSamples > numberBytes / MIN_SAMPLE_BYTES) {
+        return COMPACT_CORRUPT;
+    }
+    vector<uint8_t> encodedSamples(numberBytes);
+    in.read(reinterpret_cast<char*>(encodedSamples.data()), numberBytes);
+    if (size_t(in.gcount()) != numberBytes) {
+        return COMPACT_CORRUPT;
+    }
+
+    game.numberSamples = numberSamples;
+    game.x.resize(numberSamples * NB_VALUES_TOTAL);
+    game.value.resize(numberSamples);
+    game.policy.resize(numberSamples * NB_LABELS);
+    game.bestMoveQ.resize(numberSamples);
+    const uint8_t* data = encodedSamples.data();
+    const uint8_t* end = data + numberBytes;
+    for (size_t sampleIdx = 0; sampleIdx < numberSamples; ++sampleIdx) {
+        const size_t sampleBytes = decode_compact_sample(data, end, game.x.data() + sampleIdx * NB_VALUES_TOTAL, game.policy.data() + sampleIdx * NB_LABELS,
+                                                         game.value[sampleIdx], game.bestMoveQ[sampleIdx]);
+        if (sampleBytes == 0) {
+            return COMPACT_CORRUPT;
+        }
+        data += sampleBytes;
+    }
+    return data == end ? COMPACT_GAME_READ : COMPACT_CORRUPT;
+}
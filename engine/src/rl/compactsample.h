@@ -0,0 +1,124 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: compactsample.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Compact binary format for training samples as an alternative to the dense zarr export.
+ * Each input plane is stored either not at all (all zero), as a single scalar (constant plane),
+ * as a bitboard (binary plane) or densely as a fallback. The policy is stored as sparse (index, probability) pairs.
+ * The values are stored in native byte order.
+ *
+ * File layout: header (magic, version, NB_CHANNELS_TOTAL, NB_LABELS) followed by the games.
+ * Every game is stored as the number of samples, the number of bytes and the encoded samples.
+ */
+
+#ifndef COMPACTSAMPLE_H
+#define COMPACTSAMPLE_H
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+using namespace std;
+
+enum PlaneKind : uint8_t {
+    PLANE_EMPTY,
+    PLANE_SCALAR,
+    PLANE_BITBOARD,
+    PLANE_DENSE
+};
+
+enum CompactReadStatus : uint8_t {
+    COMPACT_GAME_READ,
+    COMPACT_END_OF_FILE,
+    // the length fields don't match the data (e.g. a truncated file)
+    COMPACT_CORRUPT
+};
+
+/**
+ * @brief The DecodedGame struct holds the samples of a single game in the same layout as the dense export
+ * (x: NB_VALUES_TOTAL int16 per sample, policy: NB_LABELS floats per sample)
+ */
+struct DecodedGame
+{
+    vector<int16_t> x;
+    vector<int16_t> value;
+    vector<float> policy;
+    vector<float> bestMoveQ;
+    size_t numberSamples = 0;
+};
+
+/**
+ * @brief encode_compact_sample Appends a single encoded training sample to the given buffer
+ * @param planes Input planes of the sample (NB_VALUES_TOTAL values)
+ * @param policy Dense policy target (NB_LABELS values)
+ * @param value Value target
+ * @param bestMoveQ Q-value of the selected move
+ * @param buffer Buffer to which the encoded sample is appended
+ */
+void encode_compact_sample(const int16_t* planes, const float* policy, int16_t value, float bestMoveQ, vector<uint8_t>& buffer);
+
+/**
+ * @brief decode_compact_sample Expands a single encoded training sample
+ * @param data Pointer to the encoded sample
+ * @param end End of the available data, which is never read
+ * @param planes Output for the input planes (NB_VALUES_TOTAL values)
+ * @param policy Output for the dense policy (NB_LABELS values)
+ * @param value Output for the value target
+ * @param bestMoveQ Output for the Q-value of the selected move
+ * @return Number of bytes which have been read or 0 if the sample exceeds the available data or has an invalid policy index
+ */
+size_t decode_compact_sample(const uint8_t* data, const uint8_t* end, int16_t* planes, float* policy, int16_t& value, float& bestMoveQ);
+
+/**
+ * @brief dense_sample_bytes Returns the number of bytes of a single sample in the dense zarr export
+ */
+size_t dense_sample_bytes();
+
+/**
+ * @brief write_compact_header Writes the file header
+ */
+void write_compact_header(ostream& out);
+
+/**
+ * @brief read_compact_header Reads and checks the file header
+ * @return True if the file has been written with the same input and policy dimensions, else false
+ */
+bool read_compact_header(istream& in);
+
+/**
+ * @brief write_compact_game Writes the already encoded samples of a single game
+ * @param out Output stream
+ * @param encodedSamples Encoded samples
+ * @param numberSamples Number of samples in encodedSamples
+ */
+void write_compact_game(ostream& out, const vector<uint8_t>& encodedSamples, uint32_t numberSamples);
+
+/**
+ * @brief read_compact_game Reads and expands the next game of a file. The length fields are validated against the available data.
+ * @param in Input stream which is positioned after the header or after the previous game
+ * @param game Output game
+ * @return COMPACT_END_OF_FILE if there is no further game, COMPACT_CORRUPT if the game is truncated or inconsistent, else COMPACT_GAME_READ
+ */
+CompactReadStatus read_compact_game(istream& in, DecodedGame& game);
+
+#endif // COMPACTSAMPLE_H
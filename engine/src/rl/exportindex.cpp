@@ -0,0 +1,186 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: exportindex.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef USE_RL
+#include "exportindex.h"
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+#ifdef _WIN32
+mutex ExportIndex::fallbackMtx;
+size_t ExportIndex::activeWriters = 0;
+#endif
+
+namespace {
+int open_index_file(const string& fileName)
+{
+#ifdef _WIN32
+    const int fd = _open(fileName.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, 0644);
+#else
+    const int fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+#endif
+    if (fd < 0) {
+        throw runtime_error("Unable to open the export index file " + fileName + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+#ifndef _WIN32
+// returns false if the lock is held by someone else and LOCK_NB is set
+bool lock_file(int fd, int operation, const string& fileName)
+{
+    while (flock(fd, operation) != 0) {
+        if (errno == EWOULDBLOCK) {
+            return false;
+        }
+        if (errno != EINTR) {
+            throw runtime_error("Unable to lock the export index file " + fileName + ": " + strerror(errno));
+        }
+    }
+    return true;
+}
+#endif
+}
+
+ExportIndex::ExportIndex(const string& fileName):
+    fileName(fileName),
+    fd(open_index_file(fileName)),
+    writersFd(open_index_file(fileName + ".writers"))
+{
+}
+
+ExportIndex::~ExportIndex()
+{
+#ifdef _WIN32
+    _close(writersFd);
+    _close(fd);
+#else
+    ::close(writersFd);
+    ::close(fd);
+#endif
+}
+
+void ExportIndex::lock()
+{
+#ifdef _WIN32
+    fallbackMtx.lock();
+#else
+    mtx.lock();
+    try {
+        lock_file(fd, LOCK_EX, fileName);
+    }
+    catch (...) {
+        mtx.unlock();
+        throw;
+    }
+#endif
+}
+
+void ExportIndex::unlock()
+{
+#ifdef _WIN32
+    fallbackMtx.unlock();
+#else
+    flock(fd, LOCK_UN);
+    mtx.unlock();
+#endif
+}
+
+bool ExportIndex::has_active_writers()
+{
+#ifdef _WIN32
+    return activeWriters != 0;
+#else
+    if (!lock_file(writersFd, LOCK_EX | LOCK_NB, fileName)) {
+        return true;
+    }
+    flock(writersFd, LOCK_UN);
+    return false;
+#endif
+}
+
+void ExportIndex::register_writer()
+{
+#ifdef _WIN32
+    ++activeWriters;
+#else
+    lock_file(writersFd, LOCK_SH, fileName);
+#endif
+}
+
+void ExportIndex::unregister_writer()
+{
+#ifdef _WIN32
+    --activeWriters;
+#else
+    flock(writersFd, LOCK_UN);
+#endif
+}
+
+ExportIndexState ExportIndex::read_state()
+{
+    ExportIndexState state;
+    char buffer[64] = {0};
+#ifdef _WIN32
+    _lseek(fd, 0, SEEK_SET);
+    const int numberBytes = _read(fd, buffer, sizeof(buffer) - 1);
+#else
+    const ssize_t numberBytes = pread(fd, buffer, sizeof(buffer) - 1, 0);
+#endif
+    if (numberBytes > 0) {
+        unsigned long long nextSample;
+        unsigned long long nextGame;
+        if (sscanf(buffer, "%llu %llu", &nextSample, &nextGame) == 2) {
+            state.nextSample = nextSample;
+            state.nextGame = nextGame;
+        }
+    }
+    return state;
+}
+
+void ExportIndex::write_state(const ExportIndexState& state)
+{
+    // fixed width entries, so the file never shrinks and no truncation is needed
+    char buffer[64];
+    const int length = snprintf(buffer, sizeof(buffer), "%020llu %020llu\n",
+                                (unsigned long long)state.nextSample, (unsigned long long)state.nextGame);
+#ifdef _WIN32
+    _lseek(fd, 0, SEEK_SET);
+    _write(fd, buffer, length);
+#else
+    if (pwrite(fd, buffer, length, 0) != length) {
+        throw runtime_error("Unable to write the export index file " + fileName + ": " + strerror(errno));
+    }
+#endif
+}
+#endif
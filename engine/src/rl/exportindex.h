@@ -0,0 +1,108 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: exportindex.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Small index file which allows several self-play processes (or exporters within one process) to write into the same data set.
+ * The index file stores the next free sample and the next free entry of "start_indices".
+ * It is protected by an exclusive file lock (flock) and every reservation is done while holding the lock.
+ * Every active writer additionally holds a shared lock on "<index>.writers", which the operating system releases
+ * if the process exits. This way a stale index of a finished or crashed run can be detected.
+ */
+
+#ifndef EXPORTINDEX_H
+#define EXPORTINDEX_H
+
+#ifdef USE_RL
+#include <string>
+#include <mutex>
+
+using namespace std;
+
+struct ExportIndexState
+{
+    // next sample of the data set which hasn't been reserved yet
+    size_t nextSample = 0;
+    // next free entry in the "start_indices" data set
+    size_t nextGame = 0;
+};
+
+class ExportIndex
+{
+private:
+    string fileName;
+    int fd;
+    // file which is locked in shared mode by every active writer
+    int writersFd;
+#ifdef _WIN32
+    // without flock() the index is only shared between exporters of the same process
+    static mutex fallbackMtx;
+    static size_t activeWriters;
+#else
+    // flock() doesn't exclude threads which use the same file descriptor
+    mutex mtx;
+#endif
+
+public:
+    /**
+     * @brief ExportIndex Opens or creates the index file
+     * @param fileName File name of the index file (e.g. "data.zarr.index")
+     */
+    ExportIndex(const string& fileName);
+    ~ExportIndex();
+    ExportIndex(const ExportIndex&) = delete;
+    ExportIndex& operator=(const ExportIndex&) = delete;
+
+    /**
+     * @brief lock Acquires the exclusive lock of the index file (blocks until it is available).
+     * The class satisfies BasicLockable, so it can be used with lock_guard.
+     */
+    void lock();
+    void unlock();
+
+    /**
+     * @brief read_state Reads the current state. An empty or unreadable index file yields the initial state.
+     * Must only be called while holding the lock.
+     */
+    ExportIndexState read_state();
+
+    /**
+     * @brief write_state Overwrites the current state. Must only be called while holding the lock.
+     */
+    void write_state(const ExportIndexState& state);
+
+    /**
+     * @brief has_active_writers Returns true if any other exporter is registered as a writer.
+     * Must only be called while holding the lock and while this exporter isn't registered.
+     */
+    bool has_active_writers();
+
+    /**
+     * @brief register_writer Registers the exporter as an active writer until unregister_writer() is called or the process exits.
+     * Must only be called while holding the lock.
+     */
+    void register_writer();
+    void unregister_writer();
+};
+#endif
+
+#endif // EXPORTINDEX_H
@@ -36,8 +36,11 @@ ostream &operator<<(ostream& os, const GamePGN& gamePGN)
        << "[Round \"" << gamePGN.round << "\"]" << endl
        << "[White \"" << gamePGN.white << "\"]" << endl
        << "[Black \"" << gamePGN.black << "\"]" << endl
-       << "[Result \"" << gamePGN.result << "\"]" << endl
-       << "[PlyCount \"" << plyCount << "\"]" << endl
+       << "[Result \"" << gamePGN.result << "\"]" << endl;
+    if (!gamePGN.termination.empty()) {
+        os << "[Termination \"" << gamePGN.termination << "\"]" << endl;
+    }
+    os << "[PlyCount \"" << plyCount << "\"]" << endl
        << "[TimeControl \"" << gamePGN.timeControl << "\"]" << endl << endl;
 
     for (size_t ply = 0; ply < plyCount; ++ply) {
@@ -59,4 +62,5 @@ void GamePGN::new_game()
 {
     gameMoves.clear();
     result = "?";
+    termination.clear();
 }
@@ -45,6 +45,8 @@ struct GamePGN
     string white = "?";
     string black = "?";
     string result = "?";
+    // optional termination tag, e.g. "adjudication" (omitted if empty)
+    string termination;
 //    string plyCount = "?";  // will be computed with gameMoves.size()
     string timeControl = "?";
     vector<string> gameMoves;
@@ -0,0 +1,141 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: openingpool.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef USE_RL
+#include "openingpool.h"
+#include "selfplay.h"
+#include "thread.h"
+#include "../domain/variants.h"
+#include "../domain/crazyhouse/inputrepresentation.h"
+#include "../domain/crazyhouse/outputrepresentation.h"
+#include "../util/blazeutil.h"
+#include "../util/randomgen.h"
+
+OpeningPool::OpeningPool(NeuralNetAPI* net, size_t poolSize, float meanInitPly, size_t maxInitPly, float rawPolicyProbTemp):
+    net(net), poolSize(poolSize), meanInitPly(meanInitPly), maxInitPly(maxInitPly), rawPolicyProbTemp(rawPolicyProbTemp)
+{
+    inputPlanes = new float[net->get_batch_size() * NB_VALUES_TOTAL];
+    valueOutputs = new float[net->get_batch_size()];
+    probOutputs = new float[net->get_batch_size() * net->get_policy_output_length()];
+}
+
+OpeningPool::~OpeningPool()
+{
+    delete [] inputPlanes;
+    delete [] valueOutputs;
+    delete [] probOutputs;
+}
+
+void OpeningPool::refill(Variant variant)
+{
+    auto uiThread = make_shared<Thread>(0);
+    vector<Board> positions(poolSize);
+    // ~Board() deletes the StateInfo of the current position, the previous ones are kept alive until the openings are finished
+    vector<vector<unique_ptr<StateInfo>>> previousStates(poolSize);
+    vector<size_t> targetPlies(poolSize);
+    vector<Opening> newOpenings(poolSize);
+    for (size_t idx = 0; idx < poolSize; ++idx) {
+        positions[idx].set(StartFENs[variant], false, variant, new StateInfo, uiThread.get());
+        const size_t ply = size_t(random_exponential<float>(1.0f/meanInitPly) + 0.5f);
+        targetPlies[idx] = clip_ply(ply, maxInitPly);
+    }
+
+    // indices of the openings which need a further ply
+    vector<size_t> activeOpenings;
+    for (size_t idx = 0; idx < poolSize; ++idx) {
+        if (targetPlies[idx] != 0) {
+            activeOpenings.push_back(idx);
+        }
+    }
+    vector<EvalInfo> evals(poolSize);
+    const size_t batchSize = net->get_batch_size();
+
+    while (!activeOpenings.empty()) {
+        // evaluate all active openings in batches of the network's batch size
+        for (size_t batchStart = 0; batchStart < activeOpenings.size(); batchStart += batchSize) {
+            const size_t batchEnd = min(batchStart + batchSize, activeOpenings.size());
+            for (size_t batchIdx = 0; batchIdx < batchEnd - batchStart; ++batchIdx) {
+                const Board& pos = positions[activeOpenings[batchStart + batchIdx]];
+                board_to_planes(&pos, pos.number_repetitions(), true, inputPlanes + batchIdx * NB_VALUES_TOTAL);
+            }
+            net->predict(inputPlanes, valueOutputs, probOutputs);
+            for (size_t batchIdx = 0; batchIdx < batchEnd - batchStart; ++batchIdx) {
+                const size_t openingIdx = activeOpenings[batchStart + batchIdx];
+                EvalInfo& eval = evals[openingIdx];
+                eval.legalMoves.clear();
+                for (const ExtMove& move : MoveList<LEGAL>(positions[openingIdx])) {
+                    eval.legalMoves.push_back(move);
+                }
+                eval.policyProbSmall.resize(eval.legalMoves.size());
+                get_probs_of_move_list(batchIdx, probOutputs, eval.legalMoves, positions[openingIdx].side_to_move(),
+                                       !net->is_policy_map(), eval.policyProbSmall, net->is_policy_map());
+            }
+        }
+
+        // sample the next move of every active opening
+        vector<size_t> nextActiveOpenings;
+        for (size_t openingIdx : activeOpenings) {
+            EvalInfo& eval = evals[openingIdx];
+            Board& pos = positions[openingIdx];
+            apply_raw_policy_temp(eval, rawPolicyProbTemp);
+            const size_t moveIdx = random_choice(eval.policyProbSmall);
+            const Move nextMove = eval.legalMoves[moveIdx];
+            if (leads_to_terminal(pos, nextMove)) {
+                continue;
+            }
+            newOpenings[openingIdx].moves.push_back(nextMove);
+            newOpenings[openingIdx].pgnMoves.push_back(pgn_move(nextMove, false, pos, eval.legalMoves, false, true));
+            previousStates[openingIdx].emplace_back(pos.get_state_info());
+            pos.do_move(nextMove, *(new StateInfo));
+            if (newOpenings[openingIdx].moves.size() < targetPlies[openingIdx]) {
+                nextActiveOpenings.push_back(openingIdx);
+            }
+        }
+        activeOpenings = move(nextActiveOpenings);
+    }
+
+    for (Opening& opening : newOpenings) {
+        openings.emplace_back(move(opening));
+    }
+}
+
+Board* OpeningPool::next_opening(GamePGN& gamePGN, Variant variant, StatesManager* states)
+{
+    if (openings.empty()) {
+        refill(variant);
+    }
+    const Opening opening = move(openings.front());
+    openings.pop_front();
+
+    Board* position = init_board(variant, states);
+    for (size_t ply = 0; ply < opening.moves.size(); ++ply) {
+        gamePGN.gameMoves.push_back(opening.pgnMoves[ply]);
+        StateInfo* newState = new StateInfo;
+        states->activeStates.push_back(newState);
+        position->do_move(opening.moves[ply], *(newState));
+    }
+    return position;
+}
+#endif
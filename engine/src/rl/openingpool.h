@@ -0,0 +1,100 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: openingpool.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Pool of pre-generated self play starting positions.
+ * The opening plies are sampled from the raw network policy for many games at once,
+ * so every ply needs only a few batched network evaluations instead of one evaluation per game.
+ */
+
+#ifndef OPENINGPOOL_H
+#define OPENINGPOOL_H
+
+#ifdef USE_RL
+#include <deque>
+#include <string>
+#include <vector>
+#include "../board.h"
+#include "../nn/neuralnetapi.h"
+#include "../manager/statesmanager.h"
+#include "gamepgn.h"
+
+using namespace std;
+
+/**
+ * @brief The Opening struct stores the moves of a pre-generated opening and their PGN representation
+ */
+struct Opening
+{
+    vector<Move> moves;
+    vector<string> pgnMoves;
+};
+
+class OpeningPool
+{
+private:
+    NeuralNetAPI* net;
+    size_t poolSize;
+    float meanInitPly;
+    size_t maxInitPly;
+    float rawPolicyProbTemp;
+    deque<Opening> openings;
+
+    float* inputPlanes;
+    float* valueOutputs;
+    float* probOutputs;
+
+    /**
+     * @brief refill Generates poolSize new openings. In every ply the positions of all unfinished openings are evaluated together.
+     * @param variant Variant to generate the openings for
+     */
+    void refill(Variant variant);
+
+public:
+    /**
+     * @brief OpeningPool
+     * @param net Network which is used for the raw policy. Its batch size defines how many positions are evaluated at once.
+     * The network must not be used by a different thread during refill().
+     * @param poolSize Number of openings which are generated at once
+     * @param meanInitPly Mean of the exponential distribution from which the opening length is sampled
+     * @param maxInitPly Maximum opening length
+     * @param rawPolicyProbTemp Probability for which a temperature scaling > 1.0f is applied
+     */
+    OpeningPool(NeuralNetAPI* net, size_t poolSize, float meanInitPly, size_t maxInitPly, float rawPolicyProbTemp);
+    ~OpeningPool();
+    OpeningPool(const OpeningPool&) = delete;
+    OpeningPool& operator=(const OpeningPool&) = delete;
+
+    /**
+     * @brief next_opening Returns the starting position of the next game. The pool is refilled if it is empty.
+     * The opening moves are added to the gamePGN as book moves.
+     * @param gamePGN Game pgn struct where the moves will be stored
+     * @param variant Variant to be played
+     * @param states State manager which takes over the newly created state objects
+     * @return New board object
+     */
+    Board* next_opening(GamePGN& gamePGN, Variant variant, StatesManager* states);
+};
+#endif
+
+#endif // OPENINGPOOL_H
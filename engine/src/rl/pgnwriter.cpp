@@ -0,0 +1,147 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: pgnwriter.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef USE_RL
+#include "pgnwriter.h"
+#include <cstdio>
+#include <sstream>
+#include <iostream>
+
+PGNWriter::PGNWriter(const string& fileName, bool compress, size_t flushGames, size_t flushIntervalS):
+    fileName(fileName),
+    compress(compress),
+    flushGames(flushGames),
+    flushInterval(flushIntervalS),
+    bufferedGames(0),
+    lastFlush(chrono::steady_clock::now())
+#ifdef USE_ZLIB
+  , gzPgnFile(nullptr)
+#endif
+{
+#ifndef USE_ZLIB
+    if (compress) {
+        cout << "Warning: PGN compression requires a build with USE_ZLIB. " << fileName << " will be written uncompressed" << endl;
+        this->compress = false;
+    }
+#endif
+    if (this->compress) {
+        this->fileName += ".gz";
+    }
+}
+
+PGNWriter::~PGNWriter()
+{
+    flush();
+#ifdef USE_ZLIB
+    if (gzPgnFile != nullptr) {
+        gzclose(gzPgnFile);
+    }
+#endif
+}
+
+void PGNWriter::write_buffer()
+{
+    lastFlush = chrono::steady_clock::now();
+    if (buffer.empty()) {
+        return;
+    }
+#ifdef USE_ZLIB
+    if (compress) {
+        if (gzPgnFile == nullptr) {
+            // appending creates a new gzip member which is read transparently by gzip/zcat
+            gzPgnFile = gzopen(fileName.c_str(), "ab");
+        }
+        if (gzPgnFile == nullptr || gzwrite(gzPgnFile, buffer.data(), unsigned(buffer.size())) != int(buffer.size())) {
+            cout << "Warning: Failed to write " << fileName << endl;
+        }
+        else {
+            gzflush(gzPgnFile, Z_SYNC_FLUSH);
+        }
+        buffer.clear();
+        bufferedGames = 0;
+        return;
+    }
+#endif
+    if (!file.is_open()) {
+        file.open(fileName, std::ios_base::app);
+    }
+    file.write(buffer.data(), streamsize(buffer.size()));
+    file.flush();
+    if (!file) {
+        cout << "Warning: Failed to write " << fileName << endl;
+        file.clear();
+    }
+    buffer.clear();
+    bufferedGames = 0;
+}
+
+void PGNWriter::write_game(const GamePGN& gamePGN)
+{
+    ostringstream ss;
+    ss << gamePGN << endl;
+    lock_guard<mutex> lock(mtx);
+    buffer += ss.str();
+    ++bufferedGames;
+    if (bufferedGames >= flushGames || chrono::steady_clock::now() - lastFlush >= flushInterval) {
+        write_buffer();
+    }
+}
+
+void PGNWriter::flush()
+{
+    lock_guard<mutex> lock(mtx);
+    write_buffer();
+}
+
+string PGNWriter::get_file_name() const
+{
+    return fileName;
+}
+
+bool write_file_atomic(const string& fileName, const string& content)
+{
+    const string tmpFileName = fileName + ".tmp";
+    {
+        ofstream tmpFile(tmpFileName, std::ios_base::trunc);
+        tmpFile << content;
+        tmpFile.close();
+        if (!tmpFile) {
+            cout << "Warning: Failed to write " << tmpFileName << endl;
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows
+    remove(fileName.c_str());
+#endif
+    // rename() replaces the destination atomically on POSIX systems
+    if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        cout << "Warning: Failed to rename " << tmpFileName << endl;
+        return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,109 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: pgnwriter.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Buffered writer for the self play and arena PGN files.
+ * The file is kept open and the games are written in blocks, either after a given number of games or after a given time,
+ * which avoids opening and closing the file for every single game (expensive on network file systems).
+ * If the engine was built with USE_ZLIB, the games can optionally be written as a gzip stream.
+ */
+
+#ifndef PGNWRITER_H
+#define PGNWRITER_H
+
+#ifdef USE_RL
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include "gamepgn.h"
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief The PGNWriter class appends games to a PGN file. All public methods are thread-safe,
+ * so a single writer can be shared by concurrently running SelfPlay objects.
+ */
+class PGNWriter
+{
+private:
+    mutex mtx;
+    string fileName;
+    bool compress;
+    // the buffer is written after this number of games or if the flush interval has passed
+    size_t flushGames;
+    chrono::seconds flushInterval;
+    string buffer;
+    size_t bufferedGames;
+    chrono::steady_clock::time_point lastFlush;
+    ofstream file;
+#ifdef USE_ZLIB
+    gzFile gzPgnFile;
+#endif
+
+    /**
+     * @brief write_buffer Writes the buffered games to the file which is opened on the first call. Expects mtx to be locked.
+     */
+    void write_buffer();
+
+public:
+    /**
+     * @brief PGNWriter
+     * @param fileName Filename of the PGN file, ".gz" is appended in case of compression
+     * @param compress If true, the games are written as gzip stream (only available if built with USE_ZLIB)
+     * @param flushGames Maximum number of buffered games
+     * @param flushIntervalS Maximum time in seconds the games are kept in the buffer (checked whenever a game is added)
+     */
+    PGNWriter(const string& fileName, bool compress, size_t flushGames = 64, size_t flushIntervalS = 60);
+    ~PGNWriter();
+
+    /**
+     * @brief write_game Adds a game to the buffer and writes the buffer if one of the flush criteria is met
+     * @param gamePGN Finished game
+     */
+    void write_game(const GamePGN& gamePGN);
+
+    /**
+     * @brief flush Writes all buffered games to the file
+     */
+    void flush();
+
+    string get_file_name() const;
+};
+
+/**
+ * @brief write_file_atomic Writes the content to a temporary file and renames it to the given file name,
+ * so readers never see a partially written file
+ * @param fileName Filename
+ * @param content Content of the file
+ * @return True on success
+ */
+bool write_file_atomic(const string& fileName, const string& content);
+
+#endif
+
+#endif // PGNWRITER_H
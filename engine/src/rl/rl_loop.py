@@ -16,6 +16,7 @@ import numpy as np
 import logging
 import datetime
 import argparse
+import shutil
 from numcodecs import Blosc
 from subprocess import PIPE, Popen
 from multiprocessing import Process, Queue
@@ -226,6 +227,7 @@ class RLLoop:
 #        set_uci_param(self.proc, "Temperature_Moves", 500) cz
         set_uci_param(self.proc, "Temperature_Moves", 50)
         set_uci_param(self.proc, "Centi_Quick_Probability", 75)
+        set_uci_param(self.proc, "Selfplay_Multi_Writer", "true" if self.args.multi_writer else "false")
 
         if is_arena is True:
 #            set_uci_param(self.proc, "Centi_Temperature", 60) cz
@@ -304,8 +306,11 @@ class RLLoop:
 
         :return:
         """
-        file_names = ["games_" + self.device_name + ".pgn",
-                      "gameIdx_" + self.device_name + ".txt"]
+        file_names = ["gameIdx_" + self.device_name + ".txt"]
+        # the games are written as a gzip stream if the UCI option Selfplay_Compress_PGN is enabled
+        for pgn_file_name in ["games_" + self.device_name + ".pgn", "games_" + self.device_name + ".pgn.gz"]:
+            if os.path.exists(pgn_file_name):
+                file_names.append(pgn_file_name)
         for file_name in file_names:
             os.rename(file_name, export_dir + file_name)
 
@@ -389,10 +394,16 @@ class RLLoop:
     def compress_dataset(self):
         """
         Loads the uncompressed data file, select all sample until the index specified in "startIdx.txt",
-        compresses it and exports it
+        compresses it and exports it.
+        With multiple writers the shared data set "data.zarr" is renamed to "data_<device>.zarr" by the process which
+        finishes it, all other processes keep their games until they finish a data set themselves.
         :return:
         """
-        data = zarr.load(self.crazyara_binary_dir + "data_" + self.device_name + ".zarr")
+        data_path = self.crazyara_binary_dir + "data_" + self.device_name + ".zarr"
+        if self.args.multi_writer and not os.path.exists(data_path):
+            logging.info("The shared data set has been completed by another process")
+            return
+        data = zarr.load(data_path)
 
         export_dir, time_stamp = self.create_export_dir()
         zarr_path = export_dir + time_stamp + ".zip"
@@ -403,6 +414,9 @@ class RLLoop:
             os.rename(export_dir, new_export_dir)
             export_dir = new_export_dir
         self._move_game_data_to_export_dir(export_dir)
+        if self.args.multi_writer:
+            # the next completed shared data set is renamed to the same file name
+            shutil.rmtree(data_path)
 
     def compare_new_weights(self):
         """
@@ -522,6 +536,9 @@ def parse_args(cmd_args: list):
                         help="How many new generated training files are needed to apply an update to the NN")
     parser.add_argument("--arena-games", type=int, default=100,
                         help="How many arena games will be done to judge the quality of the new network")
+    parser.add_argument("--multi-writer", default=False, action="store_true",
+                        help="All processes on this host write into the shared data set data.zarr. The process which"
+                             " completes it, compresses it as a single file. (default: False)")
 
     args = parser.parse_args(cmd_args)
 
@@ -30,6 +30,8 @@
 #include "thread.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 #include "uci.h"
 #include "../domain/variants.h"
 #include "../util/blazeutil.h"
@@ -52,9 +54,82 @@ void play_move_and_update(const EvalInfo& evalInfo, Board* position, StatesManag
 }
 
 
-SelfPlay::SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings):
+TrainDataExporter* new_train_data_exporter(const string& deviceName, const RLSettings& rlSettings)
+{
+    // with multiple writers all processes share a single zarr data set, which is renamed by the last writer once it is full
+    const bool multiWriter = rlSettings.multiWriterExport && !rlSettings.compactExport;
+    const string fileNameDevice = string("data_") + deviceName + string(".zarr");
+    const string fileName = multiWriter ? string("data.zarr") : fileNameDevice;
+    return new TrainDataExporter(fileName, rlSettings.numberChunks, rlSettings.chunkSize, rlSettings.compactExport, multiWriter, fileNameDevice);
+}
+
+SharedSelfPlayState::SharedSelfPlayState(const string& deviceName, const RLSettings& rlSettings):
+    exporter(new_train_data_exporter(deviceName, rlSettings)),
+    pgnWriter(make_shared<PGNWriter>(string("games_") + deviceName + string(".pgn"), rlSettings.compressPGN)),
+    claimedGames(0),
+    finishedGames(0),
+    generatedSamples(0),
+    startTime(chrono::steady_clock::now()),
+    deviceName(deviceName)
+{
+}
+
+SharedArenaState::SharedArenaState():
+    claimedGames(0),
+    decided(false)
+{
+}
+
+AdjudicationStatistics::AdjudicationStatistics():
+    searches(0), searchTimeMS(0)
+{
+    for (size_t idx = 0; idx < NB_ADJUDICATIONS; ++idx) {
+        games[idx] = 0;
+        plies[idx] = 0;
+    }
+}
+
+void AdjudicationStatistics::add_game(Adjudication adjudication, size_t plyCount)
+{
+    ++games[adjudication];
+    plies[adjudication] += plyCount;
+}
+
+float AdjudicationStatistics::estimated_saved_time_min() const
+{
+    if (games[NO_ADJUDICATION] == 0 || searches == 0) {
+        return 0;
+    }
+    const float meanGamePlies = float(plies[NO_ADJUDICATION]) / games[NO_ADJUDICATION];
+    float savedPlies = 0;
+    for (size_t idx = ADJUDICATION_TABLEBASE; idx <= ADJUDICATION_MAX_PLIES; ++idx) {
+        savedPlies += max(0.0f, games[idx] * meanGamePlies - plies[idx]);
+    }
+    return savedPlies * searchTimeMS / searches / 60000.f;
+}
+
+const char* adjudication_to_string(Adjudication adjudication)
+{
+    switch(adjudication) {
+    case NO_ADJUDICATION:
+        return "none";
+    case ADJUDICATION_TABLEBASE:
+        return "tablebase";
+    case ADJUDICATION_DRAW:
+        return "draw";
+    case ADJUDICATION_MAX_PLIES:
+        return "maxplies";
+    case ADJUDICATION_RESIGNATION:
+        return "resignation";
+    default:
+        return "unknown";
+    }
+}
+
+SelfPlay::SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings,
+                   SharedSelfPlayState* sharedState):
     rawAgent(rawAgent), mctsAgent(mctsAgent), searchLimits(searchLimits), playSettings(playSettings), rlSettings(rlSettings),
-    gameIdx(0), gamesPerMin(0), samplesPerMin(0)
+    sharedState(sharedState), arenaState(nullptr), gameIdx(0), gamesPerMin(0), samplesPerMin(0)
 {
 #ifdef MODE_CRAZYHOUSE
     gamePGN.variant = "crazyhouse";
@@ -66,11 +141,19 @@ SelfPlay::SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* se
     gamePGN.date = "?";  // TODO: Change this later
     gamePGN.round = "?";
     gamePGN.is960 = false;
-    this->exporter = new TrainDataExporter(string("data_") + mctsAgent->get_device_name() + string(".zarr"),
-                                           rlSettings->numberChunks, rlSettings->chunkSize);
-    filenamePGNSelfplay = string("games_") + mctsAgent->get_device_name() + string(".pgn");
-    filenamePGNArena = string("arena_games_")+ mctsAgent->get_device_name() + string(".pgn");
-    fileNameGameIdx = string("gameIdx_") + mctsAgent->get_device_name() + string(".txt");
+    deviceName = mctsAgent->get_device_name();
+    if (sharedState != nullptr) {
+        exporter = sharedState->exporter.get();
+        deviceName = sharedState->deviceName;
+        pgnWriterSelfplay = sharedState->pgnWriter;
+    }
+    else {
+        exporter = new_train_data_exporter(deviceName, *rlSettings);
+        pgnWriterSelfplay = make_shared<PGNWriter>(string("games_") + deviceName + string(".pgn"), rlSettings->compressPGN);
+    }
+    pgnWriterArena = make_shared<PGNWriter>(string("arena_games_")+ deviceName + string(".pgn"), rlSettings->compressPGN);
+    fileNameGameIdx = string("gameIdx_") + deviceName + string(".txt");
+    fileNameMetrics = string("metrics_") + deviceName + string(".prom");
 
     backupNodes = searchLimits->nodes;
     backupQValueWeight = mctsAgent->get_q_value_weight();
@@ -79,7 +162,15 @@ SelfPlay::SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent, SearchLimits* se
 
 SelfPlay::~SelfPlay()
 {
-    delete exporter;
+    if (sharedState == nullptr) {
+        delete exporter;
+    }
+}
+
+void SelfPlay::enable_opening_pool(NeuralNetAPI* net)
+{
+    openingPool = make_unique<OpeningPool>(net, rlSettings->openingPoolSize, playSettings->meanInitPly, playSettings->maxInitPly,
+                                           rlSettings->rawPolicyProbabilityTemperature);
 }
 
 void SelfPlay::adjust_node_count(SearchLimits* searchLimits, int randInt)
@@ -119,6 +210,46 @@ void SelfPlay::check_for_resignation(const bool allowResingation, const EvalInfo
     }
 }
 
+Adjudication SelfPlay::check_for_adjudication(const EvalInfo& evalInfo, Board* position, size_t& lowQPlies, Result& gameResult)
+{
+    // the Syzygy tables only cover standard chess positions without any pocket pieces
+    if (rlSettings->adjudicateTablebase && position->variant() == CHESS_VARIANT && !position->is_house() &&
+            Tablebases::MaxCardinality >= popcount(position->pieces()) && !position->can_castle(ANY_CASTLING)) {
+        Tablebases::ProbeState result;
+        const Tablebases::WDLScore wdlScore = probe_wdl(*position, &result);
+        if (result != Tablebases::FAIL) {
+            // the score is given from the point of view of the side to move, cursed wins and blessed losses are draws
+            switch(wdlScore) {
+            case Tablebases::WDLWin:
+                gameResult = position->side_to_move() == WHITE ? WHITE_WIN : BLACK_WIN;
+                break;
+            case Tablebases::WDLLoss:
+                gameResult = position->side_to_move() == WHITE ? BLACK_WIN : WHITE_WIN;
+                break;
+            default:
+                gameResult = DRAWN;
+            }
+            return ADJUDICATION_TABLEBASE;
+        }
+    }
+    if (rlSettings->drawAdjudicationPlies != 0) {
+        if (abs(evalInfo.bestMoveQ) < rlSettings->drawAdjudicationThreshold) {
+            if (++lowQPlies >= rlSettings->drawAdjudicationPlies) {
+                gameResult = DRAWN;
+                return ADJUDICATION_DRAW;
+            }
+        }
+        else {
+            lowQPlies = 0;
+        }
+    }
+    if (rlSettings->maxGamePlies != 0 && gamePGN.gameMoves.size() >= rlSettings->maxGamePlies) {
+        gameResult = DRAWN;
+        return ADJUDICATION_MAX_PLIES;
+    }
+    return NO_ADJUDICATION;
+}
+
 void SelfPlay::reset_search_params(bool isQuickSearch)
 {
     searchLimits->nodes = backupNodes;
@@ -132,19 +263,26 @@ void SelfPlay::generate_game(Variant variant, StatesManager* states, bool verbos
 {
     chrono::steady_clock::time_point gameStartTime = chrono::steady_clock::now();
 
-    size_t ply = size_t(random_exponential<float>(1.0f/playSettings->meanInitPly) + 0.5f);
-    ply = clip_ply(ply, playSettings->maxInitPly);
-
     srand(unsigned(int(time(nullptr))));
-    Board* position = init_starting_pos_from_raw_policy(*rawAgent, ply, gamePGN, variant, states,
-                                                        rlSettings->rawPolicyProbabilityTemperature);
+    Board* position;
+    if (openingPool != nullptr) {
+        position = openingPool->next_opening(gamePGN, variant, states);
+    }
+    else {
+        size_t ply = size_t(random_exponential<float>(1.0f/playSettings->meanInitPly) + 0.5f);
+        ply = clip_ply(ply, playSettings->maxInitPly);
+        position = init_starting_pos_from_raw_policy(*rawAgent, ply, gamePGN, variant, states,
+                                                     rlSettings->rawPolicyProbabilityTemperature);
+    }
     EvalInfo evalInfo;
     states->swap_states();
     Result gameResult;
-    exporter->new_game();
+    gameSamples.clear();
+    gameMetrics.reset();
 
-    size_t generatedSamples = 0;
     const bool allowResignation = is_resignation_allowed();
+    size_t lowQPlies = 0;
+    Adjudication adjudication = NO_ADJUDICATION;
     do {
         searchLimits->startTime = now();
         const int randInt = rand();
@@ -156,37 +294,107 @@ void SelfPlay::generate_game(Variant variant, StatesManager* states, bool verbos
             mctsAgent->update_dirichlet_epsilon(rlSettings->quickDirichletEpsilon);
         }
         adjust_node_count(searchLimits, randInt);
+        const chrono::steady_clock::time_point searchStartTime = chrono::steady_clock::now();
         mctsAgent->perform_action(position, searchLimits, evalInfo);
+        adjudicationStats.searchTimeMS += chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - searchStartTime).count();
+        ++adjudicationStats.searches;
+        gameMetrics.add_search(evalInfo, mctsAgent->get_search_counters());
         if (rlSettings->reuseTreeForSelpay) {
             mctsAgent->apply_move_to_tree(evalInfo.bestMove, true, position);
         }
 
-        if (!isQuickSearch && !exporter->is_file_full()) {
+        if (!isQuickSearch && !is_export_file_full()) {
             if (rlSettings->lowPolicyClipThreshold > 0) {
                 sharpen_distribution(evalInfo.policyProbSmall, rlSettings->lowPolicyClipThreshold);
             }
-            exporter->save_sample(position, evalInfo);
-            ++generatedSamples;
+            // the samples are buffered because the exporter might be shared with concurrently generated games
+            gameSamples.push_back({vector<float>(NB_VALUES_TOTAL), evalInfo, position->side_to_move()});
+            board_to_planes(position, position->number_repetitions(), false, gameSamples.back().inputPlanes.data());
         }
         play_move_and_update(evalInfo, position, states, gamePGN, gameResult);
         reset_search_params(isQuickSearch);
-        check_for_resignation(allowResignation, evalInfo, position, gameResult);
+        if (gameResult == NO_RESULT) {
+            check_for_resignation(allowResignation, evalInfo, position, gameResult);
+            if (gameResult != NO_RESULT) {
+                adjudication = ADJUDICATION_RESIGNATION;
+            }
+            else {
+                adjudication = check_for_adjudication(evalInfo, position, lowQPlies, gameResult);
+            }
+        }
     }
     while(gameResult == NO_RESULT);
 
+    if (adjudication != NO_ADJUDICATION && adjudication != ADJUDICATION_RESIGNATION) {
+        gamePGN.termination = "adjudication";
+    }
+    adjudicationStats.add_game(adjudication, gamePGN.gameMoves.size());
+    gameMetrics.resignations = adjudication == ADJUDICATION_RESIGNATION;
+    gameMetrics.adjudications = adjudication != NO_ADJUDICATION && adjudication != ADJUDICATION_RESIGNATION;
+    export_game(gameResult, gameStartTime, verbose);
+    clean_up(gamePGN, mctsAgent, states, position);
+    ++gameIdx;
+}
+
+void SelfPlay::export_game(Result gameResult, chrono::steady_clock::time_point gameStartTime, bool verbose)
+{
+    unique_lock<mutex> lock;
+    if (sharedState != nullptr) {
+        lock = unique_lock<mutex>(sharedState->mtx);
+    }
     // export all training samples of the generated game
+    exporter->new_game();
+    for (const GameSample& sample : gameSamples) {
+        exporter->save_sample(sample.inputPlanes.data(), sample.evalInfo, sample.sideToMove);
+    }
     exporter->export_game_samples(gameResult);
 
     set_game_result_to_pgn(gameResult);
-    write_game_to_pgn(filenamePGNSelfplay, verbose);
-    clean_up(gamePGN, mctsAgent, states, position);
+    write_game_to_pgn(pgnWriterSelfplay.get(), verbose);
 
+    if (sharedState != nullptr) {
+        ++sharedState->finishedGames;
+        sharedState->generatedSamples += gameSamples.size();
+    }
+    gameMetrics.games = 1;
+    gameMetrics.samples = gameSamples.size();
+    gameMetrics.plies = gamePGN.gameMoves.size();
+    SelfPlayMetrics& metrics = sharedState != nullptr ? sharedState->metrics : ownMetrics;
+    metrics += gameMetrics;
+    if (rlSettings->metricsIntervalS != 0 &&
+            chrono::steady_clock::now() - metrics.lastExportTime >= chrono::seconds(rlSettings->metricsIntervalS)) {
+        write_metrics(metrics);
+    }
     // measure time statistics
     if (verbose) {
         const float elapsedTimeMin = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - gameStartTime).count() / 60000.f;
-        speed_statistic_report(elapsedTimeMin, generatedSamples);
+        speed_statistic_report(elapsedTimeMin, gameSamples.size());
     }
-    ++gameIdx;
+}
+
+void SelfPlay::write_metrics(SelfPlayMetrics& metrics)
+{
+    metrics.lastExportTime = chrono::steady_clock::now();
+    write_file_atomic(fileNameMetrics, metrics.to_prometheus(deviceName, exporter->get_fill_level(), exporter->is_file_full()));
+}
+
+bool SelfPlay::is_export_file_full()
+{
+    if (sharedState != nullptr) {
+        lock_guard<mutex> lock(sharedState->mtx);
+        return exporter->is_file_full();
+    }
+    return exporter->is_file_full();
+}
+
+bool SelfPlay::claim_game(size_t numberOfGames)
+{
+    lock_guard<mutex> lock(sharedState->mtx);
+    if (numberOfGames == 0 ? exporter->is_file_full() : sharedState->claimedGames >= numberOfGames) {
+        return false;
+    }
+    ++sharedState->claimedGames;
+    return true;
 }
 
 Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPlayer, Variant variant, StatesManager* states, bool verbose)
@@ -220,7 +428,13 @@ Result SelfPlay::generate_arena_game(MCTSAgent* whitePlayer, MCTSAgent* blackPla
     }
     while(gameResult == NO_RESULT);
     set_game_result_to_pgn(gameResult);
-    write_game_to_pgn(filenamePGNArena, verbose);
+    {
+        unique_lock<mutex> lock;
+        if (arenaState != nullptr) {
+            lock = unique_lock<mutex>(arenaState->mtx);
+        }
+        write_game_to_pgn(arenaState != nullptr ? arenaState->pgnWriter.get() : pgnWriterArena.get(), verbose);
+    }
     clean_up(gamePGN, whitePlayer, states, position);
     blackPlayer->clear_game_history();
     return gameResult;
@@ -235,15 +449,12 @@ void clean_up(GamePGN& gamePGN, MCTSAgent* mctsAgent, StatesManager* states, Boa
     delete position;
 }
 
-void SelfPlay::write_game_to_pgn(const std::string& pngFileName, bool verbose)
+void SelfPlay::write_game_to_pgn(PGNWriter* pgnWriter, bool verbose)
 {
-    ofstream pgnFile;
-    pgnFile.open(pngFileName, std::ios_base::app);
     if (verbose) {
         cout << endl << gamePGN << endl;
     }
-    pgnFile << gamePGN << endl;
-    pgnFile.close();
+    pgnWriter->write_game(gamePGN);
 }
 
 void SelfPlay::set_game_result_to_pgn(Result res)
@@ -256,28 +467,48 @@ void SelfPlay::reset_speed_statistics()
     gameIdx = 0;
     gamesPerMin = 0;
     samplesPerMin = 0;
+    ownMetrics.reset();
 }
 
 void SelfPlay::speed_statistic_report(float elapsedTimeMin, size_t generatedSamples)
 {
-    // compute running cummulative average
-    gamesPerMin = (gameIdx * gamesPerMin + (1 / elapsedTimeMin)) / (gameIdx + 1);
-    samplesPerMin = (gameIdx * samplesPerMin + (generatedSamples / elapsedTimeMin)) / (gameIdx + 1);
+    size_t reportedGameIdx = gameIdx;
+    if (sharedState != nullptr) {
+        // the games overlap in time, therefore the overall throughput since the start is reported
+        const float totalTimeMin = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - sharedState->startTime).count() / 60000.f;
+        gamesPerMin = sharedState->finishedGames / totalTimeMin;
+        samplesPerMin = sharedState->generatedSamples / totalTimeMin;
+        reportedGameIdx = sharedState->finishedGames - 1;
+    }
+    else {
+        // compute running cummulative average
+        gamesPerMin = (gameIdx * gamesPerMin + (1 / elapsedTimeMin)) / (gameIdx + 1);
+        samplesPerMin = (gameIdx * samplesPerMin + (generatedSamples / elapsedTimeMin)) / (gameIdx + 1);
+    }
 
     cout << "    games    |  games/min  | samples/min " << endl
          << "-------------+-------------+-------------" << endl
          << std::setprecision(5)
-         << setw(13) << gameIdx << '|'
+         << setw(13) << reportedGameIdx << '|'
          << setw(13) << gamesPerMin << '|'
          << setw(13) << samplesPerMin << endl << endl;
+
+    if (rlSettings->adjudicateTablebase || rlSettings->drawAdjudicationPlies != 0 || rlSettings->maxGamePlies != 0) {
+        cout << "info string adjudicated";
+        for (size_t idx = ADJUDICATION_TABLEBASE; idx < NB_ADJUDICATIONS; ++idx) {
+            cout << " " << adjudication_to_string(Adjudication(idx)) << " " << adjudicationStats.games[idx];
+        }
+        cout << " estimated saved search time " << adjudicationStats.estimated_saved_time_min() << " min" << endl;
+    }
 }
 
-void SelfPlay::export_number_generated_games() const
+void SelfPlay::export_number_generated_games()
 {
-    ofstream gameIdxFile;
-    gameIdxFile.open(fileNameGameIdx);
-    gameIdxFile << gameIdx;
-    gameIdxFile.close();
+    pgnWriterSelfplay->flush();
+    if (rlSettings->metricsIntervalS != 0) {
+        write_metrics(sharedState != nullptr ? sharedState->metrics : ownMetrics);
+    }
+    write_file_atomic(fileNameGameIdx, to_string(sharedState == nullptr ? gameIdx : sharedState->finishedGames));
 }
 
 
@@ -300,36 +531,89 @@ void SelfPlay::go(size_t numberOfGames, StatesManager* states, Variant variant)
     export_number_generated_games();
 }
 
+void SelfPlay::go_concurrent(size_t numberOfGames, StatesManager* states, Variant variant)
+{
+    gamePGN.white = mctsAgent->get_name();
+    gamePGN.black = mctsAgent->get_name();
+
+    while (claim_game(numberOfGames)) {
+        generate_game(variant, states, true);
+    }
+}
+
+void SelfPlay::play_arena_game(MCTSAgent* mctsContender, bool contenderIsWhite, Variant variant, StatesManager* states,
+                               TournamentResult& tournamentResult)
+{
+    Result gameResult;
+    if (contenderIsWhite) {
+        gameResult = generate_arena_game(mctsContender, mctsAgent, variant, states, true);
+    }
+    else {
+        gameResult = generate_arena_game(mctsAgent, mctsContender, variant, states, true);
+    }
+    unique_lock<mutex> lock;
+    if (arenaState != nullptr) {
+        lock = unique_lock<mutex>(arenaState->mtx);
+    }
+    if (gameResult == DRAWN) {
+        ++tournamentResult.numberDraws;
+    }
+    else if ((gameResult == WHITE_WIN) == contenderIsWhite) {
+        ++tournamentResult.numberWins;
+    }
+    else {
+        ++tournamentResult.numberLosses;
+    }
+}
+
+bool SelfPlay::is_arena_decided(const TournamentResult& tournamentResult) const
+{
+    if (!rlSettings->arenaSPRT) {
+        return false;
+    }
+    return sprt_decision(tournamentResult, rlSettings->sprtElo0, rlSettings->sprtElo1, rlSettings->sprtAlpha, rlSettings->sprtBeta) != SPRT_CONTINUE;
+}
+
 TournamentResult SelfPlay::go_arena(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states, Variant variant)
 {
     TournamentResult tournamentResult;
     tournamentResult.playerA = mctsContender->get_name();
     tournamentResult.playerB = mctsAgent->get_name();
-    Result gameResult;
-    for (size_t idx = 0; idx < numberOfGames; ++idx) {
-        if (idx % 2 == 0) {
-            gameResult = generate_arena_game(mctsContender, mctsAgent, variant, states, true);
-            if (gameResult == WHITE_WIN) {
-                ++tournamentResult.numberWins;
-            }
-            else {
-                ++tournamentResult.numberLosses;
-            }
+    for (size_t idx = 0; idx < numberOfGames && !is_arena_decided(tournamentResult); ++idx) {
+        play_arena_game(mctsContender, idx % 2 == 0, variant, states, tournamentResult);
+        cout << "Arena: " << tournamentResult << " LLR " << tournamentResult.llr(rlSettings->sprtElo0, rlSettings->sprtElo1) << endl;
+    }
+    pgnWriterArena->flush();
+    return tournamentResult;
+}
+
+void SelfPlay::go_arena_concurrent(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states, Variant variant, SharedArenaState* arenaState)
+{
+    this->arenaState = arenaState;
+    {
+        lock_guard<mutex> lock(arenaState->mtx);
+        if (arenaState->pgnWriter == nullptr) {
+            arenaState->pgnWriter = pgnWriterArena;
         }
-        else {
-            gameResult = generate_arena_game(mctsAgent, mctsContender, variant, states, true);
-            if (gameResult == BLACK_WIN) {
-                ++tournamentResult.numberWins;
-            }
-            else {
-                ++tournamentResult.numberLosses;
+    }
+    while (true) {
+        size_t idx;
+        {
+            lock_guard<mutex> lock(arenaState->mtx);
+            if (arenaState->decided || arenaState->claimedGames >= numberOfGames) {
+                break;
             }
+            idx = arenaState->claimedGames++;
         }
-        if (gameResult == DRAWN) {
-            ++tournamentResult.numberDraws;
-        }
+        play_arena_game(mctsContender, idx % 2 == 0, variant, states, arenaState->tournamentResult);
+        lock_guard<mutex> lock(arenaState->mtx);
+        // games which are still running when the SPRT is decided are counted as well
+        arenaState->decided = is_arena_decided(arenaState->tournamentResult);
+        cout << "Arena: " << arenaState->tournamentResult << " LLR "
+             << arenaState->tournamentResult.llr(rlSettings->sprtElo0, rlSettings->sprtElo1) << endl;
     }
-    return tournamentResult;
+    arenaState->pgnWriter->flush();
+    this->arenaState = nullptr;
 }
 
 Board* init_board(Variant variant, StatesManager* states)
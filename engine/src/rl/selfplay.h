@@ -33,9 +33,117 @@
 #include "gamepgn.h"
 #include "../manager/statesmanager.h"
 #include "tournamentresult.h"
+#include "traindataexporter.h"
+#include "openingpool.h"
+#include "pgnwriter.h"
+#include "selfplaymetrics.h"
 #include "../agents/config/rlsettings.h"
 
 #ifdef USE_RL
+#include <mutex>
+
+/**
+ * @brief new_train_data_exporter Creates the exporter for the training data based on the rl settings
+ * @param deviceName Device name which is used for the file name unless all writers share a single data set
+ * @param rlSettings RL settings
+ * @return Pointer to a newly allocated exporter
+ */
+TrainDataExporter* new_train_data_exporter(const string& deviceName, const RLSettings& rlSettings);
+
+/**
+ * @brief The SharedSelfPlayState struct holds the exporter and statistics which are shared by concurrently running SelfPlay objects
+ */
+struct SharedSelfPlayState
+{
+    // guards all members and the pgn files
+    mutex mtx;
+    unique_ptr<TrainDataExporter> exporter;
+    shared_ptr<PGNWriter> pgnWriter;
+    // number of games which have been started
+    size_t claimedGames;
+    size_t finishedGames;
+    size_t generatedSamples;
+    chrono::steady_clock::time_point startTime;
+    SelfPlayMetrics metrics;
+
+    // device name which is used for all export file names
+    string deviceName;
+
+    SharedSelfPlayState(const string& deviceName, const RLSettings& rlSettings);
+};
+
+/**
+ * @brief The SharedArenaState struct holds the tournament result of concurrently played arena games
+ */
+struct SharedArenaState
+{
+    // guards all members and the arena pgn file
+    mutex mtx;
+    TournamentResult tournamentResult;
+    // writer of the first SelfPlay object which joins the arena, it is used by all of them
+    shared_ptr<PGNWriter> pgnWriter;
+    // number of games which have been started
+    size_t claimedGames;
+    // true if the SPRT has accepted one of the hypotheses
+    bool decided;
+
+    SharedArenaState();
+};
+
+/**
+ * @brief The GameSample struct stores a training sample until the game result is known
+ */
+struct GameSample
+{
+    vector<float> inputPlanes;
+    EvalInfo evalInfo;
+    Color sideToMove;
+};
+
+enum Adjudication {
+    NO_ADJUDICATION,
+    ADJUDICATION_TABLEBASE,
+    ADJUDICATION_DRAW,
+    ADJUDICATION_MAX_PLIES,
+    // resignations are only counted and don't contribute to the estimated saved time
+    ADJUDICATION_RESIGNATION,
+    NB_ADJUDICATIONS
+};
+
+/**
+ * @brief The AdjudicationStatistics struct counts the adjudicated games and estimates the search time which has been saved by them
+ */
+struct AdjudicationStatistics
+{
+    // number of games and summed up game lengths for each adjudication type (NO_ADJUDICATION: games which were played until the end)
+    size_t games[NB_ADJUDICATIONS];
+    size_t plies[NB_ADJUDICATIONS];
+    // number of searches and their total duration
+    size_t searches;
+    size_t searchTimeMS;
+
+    AdjudicationStatistics();
+
+    /**
+     * @brief add_game Adds a finished game to the statistics
+     * @param adjudication Adjudication type which ended the game
+     * @param plyCount Length of the game in plies
+     */
+    void add_game(Adjudication adjudication, size_t plyCount);
+
+    /**
+     * @brief estimated_saved_time_min Estimates the saved search time in minutes.
+     * It's assumed that adjudicated games would have had the average length of the games which were played until the end
+     * and that every missing ply would have needed the average search time.
+     */
+    float estimated_saved_time_min() const;
+};
+
+/**
+ * @brief adjudication_to_string Returns a const char* representation for the enum Adjudication
+ */
+const char* adjudication_to_string(Adjudication adjudication);
+
 /**
  * @brief update_states_after_move Plays the best move of evalInfo and updates the relevant set of variables
  * @param evalInfo Struct which contains the best move and all legal moves
@@ -57,9 +165,24 @@ private:
     RLSettings* rlSettings;
     GamePGN gamePGN;
     TrainDataExporter* exporter;
-    string filenamePGNSelfplay;
-    string filenamePGNArena;
+    // is nullptr if the SelfPlay object runs on its own
+    SharedSelfPlayState* sharedState;
+    // is only set while concurrent arena games are played
+    SharedArenaState* arenaState;
+    vector<GameSample> gameSamples;
+    AdjudicationStatistics adjudicationStats;
+    // metrics of the current game and of all games of this object (the shared metrics are used in case of a shared state)
+    SelfPlayMetrics gameMetrics;
+    SelfPlayMetrics ownMetrics;
+    // pre-generated starting positions, is nullptr if the openings are generated one by one
+    unique_ptr<OpeningPool> openingPool;
+    // the self play writer is shared with the other SelfPlay objects of the shared state
+    shared_ptr<PGNWriter> pgnWriterSelfplay;
+    shared_ptr<PGNWriter> pgnWriterArena;
     string fileNameGameIdx;
+    string fileNameMetrics;
+    // device name which is used for all export file names
+    string deviceName;
     size_t gameIdx;
     float gamesPerMin;
     float samplesPerMin;
@@ -74,6 +197,34 @@ private:
      */
     void generate_game(Variant variant, StatesManager* states, bool verbose);
 
+    /**
+     * @brief export_game Exports the buffered samples and writes the game to the pgn file.
+     * In case of a shared state the export is guarded by the shared mutex.
+     * @param gameResult Final result of the game
+     * @param gameStartTime Start time which is used for the speed statistics
+     * @param verbose If true the game and the speed statistics are printed to stdout
+     */
+    void export_game(Result gameResult, chrono::steady_clock::time_point gameStartTime, bool verbose);
+
+    /**
+     * @brief write_metrics Rewrites the metrics file in the Prometheus text format. It's replaced atomically.
+     * In case of a shared state the shared mutex must be locked.
+     * @param metrics Metrics to export
+     */
+    void write_metrics(SelfPlayMetrics& metrics);
+
+    /**
+     * @brief is_export_file_full Returns true if the exporter cannot take any further samples
+     */
+    bool is_export_file_full();
+
+    /**
+     * @brief claim_game Reserves the next game of a concurrent self play run
+     * @param numberOfGames Total number of games to generate (0 means until the export file is full)
+     * @return True if another game shall be generated
+     */
+    bool claim_game(size_t numberOfGames);
+
     /**
      * @brief generate_arena_game Generates a game of the current NN weights vs the new acquired weights
      * @param whitePlayer MCTSAgent which will play with the white pieces
@@ -83,12 +234,26 @@ private:
      */
     Result generate_arena_game(MCTSAgent *whitePlayer, MCTSAgent *blackPlayer, Variant variant, StatesManager* states, bool verbose);
 
+    /**
+     * @brief play_arena_game Plays an arena game between the contender and the producer and adds it to the tournament result
+     * @param mctsContender MCTSAgent using the new NN weights
+     * @param contenderIsWhite True if the contender plays with the white pieces
+     * @param tournamentResult Tournament result to update
+     */
+    void play_arena_game(MCTSAgent* mctsContender, bool contenderIsWhite, Variant variant, StatesManager* states, TournamentResult& tournamentResult);
+
+    /**
+     * @brief is_arena_decided Returns true if the SPRT is enabled and has accepted one of the hypotheses
+     * @param tournamentResult Current tournament result
+     */
+    bool is_arena_decided(const TournamentResult& tournamentResult) const;
+
     /**
      * @brief write_game_to_pgn Writes the game log to a pgn file
-     * @param pngFileName Filename to export
+     * @param pgnWriter Buffered writer of the pgn file
      * @param verbose If true, game will also be printed to stdout
      */
-    void write_game_to_pgn(const std::string& pngFileName, bool verbose);
+    void write_game_to_pgn(PGNWriter* pgnWriter, bool verbose);
 
     /**
      * @brief set_game_result Sets the game result to the gamePGN object
@@ -106,11 +271,6 @@ private:
      */
     void speed_statistic_report(float elapsedTimeMin, size_t generatedSamples);
 
-    /**
-     * @brief export_number_generated_games Creates a file which describes how many games have been generated in the newly created .zip-file
-     */
-    void export_number_generated_games() const;
-
     /**
      * @brief adjust_node_count Adjusts the amount of nodes to search based on rlSettings->nodeRandomFactor to increase playing variety
      * @param searchLimits searchLimit struct to be modified
@@ -139,6 +299,17 @@ private:
      */
     void check_for_resignation(const bool allowResignation, const EvalInfo& evalInfo, const Position* position, Result& gameResult);
 
+    /**
+     * @brief check_for_adjudication Modifies gameResult if the game can be adjudicated by a tablebase probe,
+     * a Q-value close to zero over several plies or by reaching the maximum game length (see RLSettings)
+     * @param evalInfo Evaluation struct
+     * @param position Board position. It is expected that the evalBestMove has already been applied.
+     * @param lowQPlies Number of consecutive plies with |Q| below the draw threshold, will be updated
+     * @param gameResult Game result which may be modified
+     * @return Adjudication type which has been applied or NO_ADJUDICATION
+     */
+    Adjudication check_for_adjudication(const EvalInfo& evalInfo, Board* position, size_t& lowQPlies, Result& gameResult);
+
     /**
      * @brief reset_search_params Resets all search parameters to their initial values
      * @param Signals if a quick search was done
@@ -153,8 +324,11 @@ public:
      * @param searchLimits Search limit configuration struct
      * @param playSettings Playing setting configuration struct
      * @param RLSettings Additional settings for reinforcement learning usage
+     * @param sharedState Optional state which is shared with other concurrently running SelfPlay objects.
+     * If given, its exporter is used instead of creating a new one.
      */
-    SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent,  SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings);
+    SelfPlay(RawNetAgent* rawAgent, MCTSAgent* mctsAgent,  SearchLimits* searchLimits, PlaySettings* playSettings, RLSettings* rlSettings,
+             SharedSelfPlayState* sharedState = nullptr);
     ~SelfPlay();
 
     /**
@@ -165,6 +339,28 @@ public:
      */
     void go(size_t numberOfGames, StatesManager* states, Variant variant);
 
+    /**
+     * @brief go_concurrent Generates games as long as the shared number of games hasn't been reached.
+     * Multiple SelfPlay objects with the same shared state can run this function concurrently in different threads.
+     * @param numberOfGames Total number of games to generate over all SelfPlay objects (0 means until the export file is full)
+     * @param states States manager handle of this SelfPlay object
+     * @param variant Variant to generate games for
+     */
+    void go_concurrent(size_t numberOfGames, StatesManager* states, Variant variant);
+
+    /**
+     * @brief enable_opening_pool Generates the starting positions of rlSettings->openingPoolSize games at once with batched evaluations
+     * of the raw network policy instead of evaluating every opening ply of every game with a batch size of 1
+     * @param net Network with a batch size > 1 which isn't used by other threads while no search is running (e.g. a net of a search thread)
+     */
+    void enable_opening_pool(NeuralNetAPI* net);
+
+    /**
+     * @brief export_number_generated_games Flushes the pgn file and creates a file which describes how many games have been generated
+     * in the newly created .zip-file. The file is replaced atomically.
+     */
+    void export_number_generated_games();
+
     /**
      * @brief go_arena Starts comparision matches between the original mctsAgent with the old NN weights and
      * the mctsContender which uses the new updated wieghts
@@ -174,8 +370,21 @@ public:
      * @param variant Variant to generate games for
      * @return Score in respect to the contender, as floating point number.
      *  Wins give 1.0 points, 0.5 for draw, 0.0 for loss.
+     * If the SPRT is enabled (rlSettings->arenaSPRT), the arena stops as soon as one of the hypotheses is accepted.
      */
     TournamentResult go_arena(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states, Variant variant);
+
+    /**
+     * @brief go_arena_concurrent Plays arena games as long as the shared number of games hasn't been reached and the SPRT is undecided.
+     * Multiple SelfPlay objects with the same arena state can run this function concurrently in different threads.
+     * The contender plays white in all games with an even game index.
+     * @param mctsContender MCTSAgent using different NN weights
+     * @param numberOfGames Maximum number of games over all SelfPlay objects
+     * @param states States manager handle of this SelfPlay object
+     * @param variant Variant to generate games for
+     * @param arenaState Shared state which accumulates the tournament result
+     */
+    void go_arena_concurrent(MCTSAgent *mctsContender, size_t numberOfGames, StatesManager* states, Variant variant, SharedArenaState* arenaState);
 };
 #endif
 
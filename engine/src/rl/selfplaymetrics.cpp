@@ -0,0 +1,114 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: selfplaymetrics.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef USE_RL
+#include "selfplaymetrics.h"
+#include <sstream>
+
+SelfPlayMetrics::SelfPlayMetrics()
+{
+    reset();
+}
+
+void SelfPlayMetrics::reset()
+{
+    startTime = chrono::steady_clock::now();
+    lastExportTime = startTime;
+    games = 0;
+    samples = 0;
+    plies = 0;
+    resignations = 0;
+    adjudications = 0;
+    searches = 0;
+    nodes = 0;
+    searchTimeMS = 0;
+    tbHits = 0;
+    searchCounters.reset();
+}
+
+void SelfPlayMetrics::add_search(const EvalInfo& evalInfo, const SearchCounters& counters)
+{
+    ++searches;
+    nodes += evalInfo.nodes - evalInfo.nodesPreSearch;
+    searchTimeMS += evalInfo.calculate_elapsed_time_ms();
+    tbHits += evalInfo.tbHits;
+    searchCounters += counters;
+}
+
+SelfPlayMetrics& SelfPlayMetrics::operator+=(const SelfPlayMetrics& other)
+{
+    games += other.games;
+    samples += other.samples;
+    plies += other.plies;
+    resignations += other.resignations;
+    adjudications += other.adjudications;
+    searches += other.searches;
+    nodes += other.nodes;
+    searchTimeMS += other.searchTimeMS;
+    tbHits += other.tbHits;
+    searchCounters += other.searchCounters;
+    return *this;
+}
+
+/**
+ * @brief safe_ratio Returns numerator / denominator or 0 if the denominator is 0
+ */
+static double safe_ratio(double numerator, double denominator)
+{
+    return denominator == 0 ? 0 : numerator / denominator;
+}
+
+string SelfPlayMetrics::to_prometheus(const string& device, float exportFillLevel, bool exportFull) const
+{
+    const double uptimeS = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count() / 1000.0;
+    const string label = "{device=\"" + device + "\"}";
+    ostringstream os;
+    auto add_metric = [&](const string& name, const string& type, const string& help, double value) {
+        os << "# HELP crazyara_selfplay_" << name << " " << help << "\n"
+           << "# TYPE crazyara_selfplay_" << name << " " << type << "\n"
+           << "crazyara_selfplay_" << name << label << " " << value << "\n";
+    };
+    add_metric("uptime_seconds", "gauge", "Time since the start of the self play run", uptimeS);
+    add_metric("games_total", "counter", "Number of generated games", games);
+    add_metric("samples_total", "counter", "Number of exported training samples", samples);
+    add_metric("games_per_minute", "gauge", "Generated games per minute", safe_ratio(games * 60.0, uptimeS));
+    add_metric("samples_per_minute", "gauge", "Exported training samples per minute", safe_ratio(samples * 60.0, uptimeS));
+    add_metric("mean_game_length_plies", "gauge", "Average game length in plies", safe_ratio(plies, games));
+    add_metric("nodes_per_second", "gauge", "Average number of new nodes per second of search time", safe_ratio(nodes * 1000.0, searchTimeMS));
+    add_metric("batch_fill_ratio", "gauge", "Evaluated positions relative to the capacity of the evaluated batches",
+               safe_ratio(searchCounters.nnSamples, searchCounters.nnBatchSlots));
+    add_metric("transposition_hit_ratio", "gauge", "Fraction of the expanded nodes which reused the value of a transposition",
+               safe_ratio(searchCounters.transpositions, searchCounters.transpositions + searchCounters.nnSamples));
+    add_metric("terminal_hits_total", "counter", "Number of simulations which ended in a terminal node", searchCounters.terminalHits);
+    add_metric("collisions_total", "counter", "Number of simulations which collided with a node waiting for evaluation", searchCounters.collisions);
+    add_metric("tablebase_hits_total", "counter", "Number of tablebase hits", tbHits);
+    add_metric("resignation_ratio", "gauge", "Fraction of the games which ended by resignation", safe_ratio(resignations, games));
+    add_metric("adjudication_ratio", "gauge", "Fraction of the games which ended by adjudication", safe_ratio(adjudications, games));
+    add_metric("export_fill_ratio", "gauge", "Fill level of the training data export", exportFillLevel);
+    add_metric("export_full", "gauge", "1 if the training data export is full", exportFull ? 1 : 0);
+    return os.str();
+}
+#endif
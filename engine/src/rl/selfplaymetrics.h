@@ -0,0 +1,93 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: selfplaymetrics.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Self play counters which are periodically exported as a metrics file in the Prometheus text format,
+ * so the throughput of all workers can be monitored by a scraper without parsing stdout.
+ */
+
+#ifndef SELFPLAYMETRICS_H
+#define SELFPLAYMETRICS_H
+
+#ifdef USE_RL
+#include <chrono>
+#include <string>
+#include "../evalinfo.h"
+#include "../searchthread.h"
+
+using namespace std;
+
+/**
+ * @brief The SelfPlayMetrics struct accumulates the statistics of all generated games.
+ * Every game gathers its own metrics which are merged into the metrics of the worker (or of the shared self play state) when it's exported.
+ */
+struct SelfPlayMetrics
+{
+    chrono::steady_clock::time_point startTime;
+    // time of the last export of the metrics file
+    chrono::steady_clock::time_point lastExportTime;
+    size_t games;
+    size_t samples;
+    size_t plies;
+    size_t resignations;
+    size_t adjudications;
+    size_t searches;
+    // nodes which have been added by the searches (excluding the reused subtrees)
+    size_t nodes;
+    size_t searchTimeMS;
+    size_t tbHits;
+    SearchCounters searchCounters;
+
+    SelfPlayMetrics();
+
+    /**
+     * @brief reset Sets all counters to zero and the start time to now
+     */
+    void reset();
+
+    /**
+     * @brief add_search Adds the statistics of a finished search
+     * @param evalInfo Evaluation struct of the search
+     * @param counters Search counters of the search
+     */
+    void add_search(const EvalInfo& evalInfo, const SearchCounters& counters);
+
+    /**
+     * @brief operator += Adds all counters of the given metrics (start and export times are kept)
+     */
+    SelfPlayMetrics& operator+=(const SelfPlayMetrics& other);
+
+    /**
+     * @brief to_prometheus Returns the metrics in the Prometheus text exposition format
+     * @param device Device name which is used as label
+     * @param exportFillLevel Fill level of the training data export in [0, 1]
+     * @param exportFull True if the export file is full
+     * @return string
+     */
+    string to_prometheus(const string& device, float exportFillLevel, bool exportFull) const;
+};
+
+#endif
+
+#endif // SELFPLAYMETRICS_H
@@ -25,6 +25,32 @@
 
 #include "tournamentresult.h"
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+// maximum elo difference which is reported for a score of 0% or 100%
+const float MAX_ELO = 1000.0f;
+
+float score_to_elo(float score)
+{
+    if (score <= 0.0f || score >= 1.0f) {
+        return score <= 0.0f ? -MAX_ELO : MAX_ELO;
+    }
+    return std::max(-MAX_ELO, std::min(MAX_ELO, -400.0f * std::log10(1.0f / score - 1.0f)));
+}
+
+float elo_to_score(float elo)
+{
+    return 1.0f / (1.0f + std::pow(10.0f, -elo / 400.0f));
+}
+
+// variance of a single game result
+float score_variance(const TournamentResult& result)
+{
+    const float score = result.score();
+    return (result.numberWins * (1.0f - score) * (1.0f - score) + result.numberDraws * (0.5f - score) * (0.5f - score) +
+            result.numberLosses * score * score) / result.numberGames();
+}
 
 TournamentResult::TournamentResult() :
     numberWins(0),
@@ -44,11 +70,51 @@ float TournamentResult::score() const
     return (numberWins + numberDraws * 0.5f)/ numberGames();
 }
 
+float TournamentResult::elo() const
+{
+    return score_to_elo(score());
+}
+
+float TournamentResult::elo_error() const
+{
+    const float stdError = std::sqrt(score_variance(*this) / numberGames());
+    return (score_to_elo(score() + 1.96f * stdError) - score_to_elo(score() - 1.96f * stdError)) / 2;
+}
+
+float TournamentResult::llr(float elo0, float elo1) const
+{
+    if (numberGames() == 0) {
+        return 0;
+    }
+    const float variance = score_variance(*this);
+    if (variance == 0) {
+        return 0;
+    }
+    const float score0 = elo_to_score(elo0);
+    const float score1 = elo_to_score(elo1);
+    return (score1 - score0) * (2 * score() - score0 - score1) / (2 * variance / numberGames());
+}
+
+SPRTResult sprt_decision(const TournamentResult& result, float elo0, float elo1, float alpha, float beta)
+{
+    const float llr = result.llr(elo0, elo1);
+    if (llr >= std::log((1 - beta) / alpha)) {
+        return SPRT_ACCEPT_H1;
+    }
+    if (llr <= std::log(beta / (1 - alpha))) {
+        return SPRT_ACCEPT_H0;
+    }
+    return SPRT_CONTINUE;
+}
+
 std::ostream &operator<<(std::ostream &os, const TournamentResult &result)
 {
     os << result.playerA << "-" << result.playerB << ": " << result.numberWins
        << " - " << result.numberDraws << " - " << result.numberLosses << " [" <<
           std::setprecision(2) << result.score() << "]";
+    if (result.numberGames() != 0) {
+        os << std::fixed << std::setprecision(1) << " elo " << result.elo() << " +/- " << result.elo_error() << std::defaultfloat;
+    }
     return os;
 }
 
@@ -25,6 +25,7 @@
  * The TournamentResult struct stores the result of an arena tournament.
  * Arena tournament can be used to track the elo progress in self play mode and to decide if the current
  * NN producer weights shall be switched.
+ * The decision can be done by a sequential probability ratio test (SPRT) which allows stopping the arena early.
  */
 
 #ifndef TOURNAMENTRESULT_H
@@ -59,11 +60,51 @@ struct TournamentResult {
      * @return score value
      */
      float score() const;
+
+    /**
+     * @brief elo Estimates the elo difference of the first player based on the score
+     * @return elo difference (clipped to +/- 1000 for a score of 100% or 0%)
+     */
+    float elo() const;
+
+    /**
+     * @brief elo_error Returns half the width of the 95% confidence interval of the elo estimate
+     * based on the observed win, draw and loss frequencies
+     * @return elo error
+     */
+    float elo_error() const;
+
+    /**
+     * @brief llr Computes the log-likelihood ratio of the hypotheses H1: elo = elo1 against H0: elo = elo0
+     * using the normal approximation of the trinomial game outcome (GSPRT)
+     * @param elo0 Elo difference of H0
+     * @param elo1 Elo difference of H1
+     * @return log-likelihood ratio, 0 if the variance of the results is still 0
+     */
+    float llr(float elo0, float elo1) const;
+};
+
+enum SPRTResult {
+    SPRT_CONTINUE,
+    SPRT_ACCEPT_H0,
+    SPRT_ACCEPT_H1
 };
 
+/**
+ * @brief sprt_decision Evaluates the SPRT for the current tournament result
+ * @param result Current tournament result
+ * @param elo0 Elo difference of H0 (e.g. 0)
+ * @param elo1 Elo difference of H1 (e.g. 10)
+ * @param alpha Probability of a false positive (accepting H1 although H0 is true)
+ * @param beta Probability of a false negative (accepting H0 although H1 is true)
+ * @return SPRT_ACCEPT_H1 if the LLR exceeds log((1-beta)/alpha), SPRT_ACCEPT_H0 if it falls below log(beta/(1-alpha)),
+ * else SPRT_CONTINUE
+ */
+SPRTResult sprt_decision(const TournamentResult& result, float elo0, float elo1, float alpha, float beta);
+
 /**
  * @brief operator << Returns ostream for trounament result summary in the form
- *  "<PLAYER_A>-<PLAYER_B>: <NUMBER_WINS> - <NUMBER_DRAWS> - <NUMBER_LOSSES> [<SCORE>]"
+ *  "<PLAYER_A>-<PLAYER_B>: <NUMBER_WINS> - <NUMBER_DRAWS> - <NUMBER_LOSSES> [<SCORE>] elo <ELO> +/- <ELO_ERROR>"
  * @param os ostream
  * @param result Tournament result to print
  * @return osream
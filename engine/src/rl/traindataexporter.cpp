@@ -26,18 +26,32 @@
 #ifdef USE_RL
 #include "traindataexporter.h"
 #include <inttypes.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
 #include "../util/communication.h"
 
 void TrainDataExporter::save_sample(const Board *pos, const EvalInfo& eval)
+{
+    float inputPlanes[NB_VALUES_TOTAL];
+    board_to_planes(pos, pos->number_repetitions(), false, inputPlanes);
+    save_sample(inputPlanes, eval, pos->side_to_move());
+}
+
+void TrainDataExporter::save_sample(const float* inputPlanes, const EvalInfo& eval, Color sideToMove)
 {
     if (startIdx+curSampleIdx >= numberSamples) {
         info_string("Extended number of maximum samples");
         return;
     }
-    save_planes(pos);
-    save_policy(eval.legalMoves, eval.policyProbSmall, pos->side_to_move());
+    if (curSampleIdx == gameCapacity) {
+        allocate_game_buffers(2 * gameCapacity);
+    }
+    save_planes(inputPlanes);
+    save_policy(eval.legalMoves, eval.policyProbSmall, sideToMove);
     save_best_move_q(eval);
-    save_side_to_move(pos->side_to_move());
+    save_side_to_move(sideToMove);
     ++curSampleIdx;
     // value will be set later in export_game_result()
     firstMove = false;
@@ -46,29 +60,13 @@ void TrainDataExporter::save_sample(const Board *pos, const EvalInfo& eval)
 void TrainDataExporter::save_best_move_q(const EvalInfo &eval)
 {
     // Q value of "best" move (a.k.a selected move after mcts search)
-    xt::xarray<float> qArray({ 1 }, eval.bestMoveQ);
-
-    if (firstMove) {
-        gameBestMoveQ = qArray;
-    }
-    else {
-        // concatenate the sample to array for the current game
-        gameBestMoveQ = xt::concatenate(xtuple(gameBestMoveQ, qArray));
-    }
+    gameBestMoveQ(curSampleIdx) = eval.bestMoveQ;
 }
 
 void TrainDataExporter::save_side_to_move(Color col)
 {
     // in the case of WHITE a +1 is saved else -1 for BLACK
-    xt::xarray<int16_t> valueArray({ 1 }, -(col * 2 - 1));
-
-    if (firstMove) {
-        gameValue = valueArray;
-    }
-    else {
-        // concatenate the sample to array for the current game
-        gameValue = xt::concatenate(xtuple(gameValue, valueArray));
-    }
+    gameValue(curSampleIdx) = -(col * 2 - 1);
 }
 
 void TrainDataExporter::export_game_samples(Result result) {
@@ -80,39 +78,357 @@ void TrainDataExporter::export_game_samples(Result result) {
     // game value update
     apply_result_to_value(result);
 
-    // write value to roi
-    z5::types::ShapeType offset = { startIdx };
-    z5::types::ShapeType offsetPlanes = { startIdx, 0, 0, 0 };
-    z5::multiarray::writeSubarray<int16_t>(dx, gameX, offsetPlanes.begin());
-    z5::multiarray::writeSubarray<int16_t>(dValue, gameValue, offset.begin());
-    z5::multiarray::writeSubarray<float>(dbestMoveQ, gameBestMoveQ, offset.begin());
-    z5::types::ShapeType offsetPolicy = { startIdx, 0 };
-    z5::multiarray::writeSubarray<float>(dPolicy, gamePolicy, offsetPolicy.begin());
+    // only the filled part of the game buffers is handed over to the writer thread
+    unique_ptr<ExportGame> game = make_unique<ExportGame>();
+    game->x.assign(gameX.data(), gameX.data() + curSampleIdx * NB_VALUES_TOTAL);
+    game->value.assign(gameValue.data(), gameValue.data() + curSampleIdx);
+    game->policy.assign(gamePolicy.data(), gamePolicy.data() + curSampleIdx * NB_LABELS);
+    game->bestMoveQ.assign(gameBestMoveQ.data(), gameBestMoveQ.data() + curSampleIdx);
+    game->numberSamples = curSampleIdx;
 
     startIdx += curSampleIdx;
     gameIdx++;
-    save_start_idx();
+    game->nextStartIdx = int32_t(startIdx);
+
+    {
+        lock_guard<mutex> lock(queueMtx);
+        exportQueue.push_back(move(game));
+    }
+    queueCondition.notify_one();
+}
+
+void TrainDataExporter::close()
+{
+    if (!writerThread.joinable()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(queueMtx);
+        stopWriter = true;
+    }
+    queueCondition.notify_one();
+    writerThread.join();
+
+    if (compactExport) {
+        compactFile.close();
+        cout << "Compact export: " << compactSamples << " samples, "
+             << (compactSamples == 0 ? 0 : compactBytes / compactSamples) << " bytes/sample (zarr: "
+             << dense_sample_bytes() << " bytes/sample)" << endl;
+        return;
+    }
+    if (exportIndex != nullptr) {
+        // the remaining games are committed as well, the reserved range doesn't need to fill complete chunks
+        commit_games();
+        leave_shared_dataset();
+        if (discardedSamples != 0) {
+            cout << "Discarded " << discardedSamples << " samples which didn't fit into the shared export file" << endl;
+        }
+        return;
+    }
+    // the last chunk is usually incomplete
+    if (chunkFill != 0) {
+        write_chunk(chunkFill);
+    }
+    write_start_indices();
+}
+
+void TrainDataExporter::write_compact_game(const ExportGame& game)
+{
+    encodedGame.clear();
+    for (size_t sampleIdx = 0; sampleIdx < game.numberSamples; ++sampleIdx) {
+        encode_compact_sample(game.x.data() + sampleIdx * NB_VALUES_TOTAL, game.policy.data() + sampleIdx * NB_LABELS,
+                              game.value[sampleIdx], game.bestMoveQ[sampleIdx], encodedGame);
+    }
+    ::write_compact_game(compactFile, encodedGame, uint32_t(game.numberSamples));
+    compactBytes += encodedGame.size();
+    compactSamples += game.numberSamples;
+}
+
+void TrainDataExporter::run_writer()
+{
+    while (true) {
+        unique_ptr<ExportGame> game;
+        {
+            unique_lock<mutex> lock(queueMtx);
+            queueCondition.wait(lock, [this]{ return stopWriter || !exportQueue.empty(); });
+            if (exportQueue.empty()) {
+                // stopWriter is set and all games have been processed
+                return;
+            }
+            game = move(exportQueue.front());
+            exportQueue.pop_front();
+        }
+        if (compactExport) {
+            write_compact_game(*game);
+        }
+        else if (exportIndex != nullptr) {
+            pendingSamples += game->numberSamples;
+            pendingGames.push_back(move(game));
+            if (pendingSamples >= chunkSize) {
+                commit_games();
+            }
+        }
+        else {
+            add_game_to_chunk(*game);
+        }
+    }
 }
 
-TrainDataExporter::TrainDataExporter(const string& fileName, size_t numberChunks, size_t chunkSize):
+void TrainDataExporter::add_game_to_chunk(const ExportGame& game)
+{
+    size_t sampleIdx = 0;
+    while (sampleIdx < game.numberSamples) {
+        const size_t numberCopied = min(game.numberSamples - sampleIdx, chunkSize - chunkFill);
+        copy_n(game.x.data() + sampleIdx * NB_VALUES_TOTAL, numberCopied * NB_VALUES_TOTAL, chunkX.data() + chunkFill * NB_VALUES_TOTAL);
+        copy_n(game.value.data() + sampleIdx, numberCopied, chunkValue.data() + chunkFill);
+        copy_n(game.policy.data() + sampleIdx * NB_LABELS, numberCopied * NB_LABELS, chunkPolicy.data() + chunkFill * NB_LABELS);
+        copy_n(game.bestMoveQ.data() + sampleIdx, numberCopied, chunkBestMoveQ.data() + chunkFill);
+        chunkFill += numberCopied;
+        sampleIdx += numberCopied;
+        if (chunkFill == chunkSize) {
+            write_chunk(chunkSize);
+        }
+    }
+
+    pendingStartIndices.push_back(game.nextStartIdx);
+    if (pendingStartIndices.size() == chunkSize) {
+        write_start_indices();
+    }
+}
+
+void TrainDataExporter::commit_games()
+{
+    if (pendingGames.empty()) {
+        return;
+    }
+    // the pending games are copied into continuous buffers before the lock is acquired
+    if (chunkValue.size() < pendingSamples) {
+        chunkX = xt::xarray<int16_t>::from_shape({ pendingSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH });
+        chunkValue = xt::xarray<int16_t>::from_shape({ pendingSamples });
+        chunkPolicy = xt::xarray<float>::from_shape({ pendingSamples, NB_LABELS });
+        chunkBestMoveQ = xt::xarray<float>::from_shape({ pendingSamples });
+    }
+    size_t sampleIdx = 0;
+    for (const unique_ptr<ExportGame>& game : pendingGames) {
+        copy_n(game->x.data(), game->numberSamples * NB_VALUES_TOTAL, chunkX.data() + sampleIdx * NB_VALUES_TOTAL);
+        copy_n(game->value.data(), game->numberSamples, chunkValue.data() + sampleIdx);
+        copy_n(game->policy.data(), game->numberSamples * NB_LABELS, chunkPolicy.data() + sampleIdx * NB_LABELS);
+        copy_n(game->bestMoveQ.data(), game->numberSamples, chunkBestMoveQ.data() + sampleIdx);
+        sampleIdx += game->numberSamples;
+    }
+
+    size_t datasetIdx;
+    size_t numberStored;
+    size_t headEnd;
+    size_t tailBegin;
+    {
+        lock_guard<ExportIndex> lock(*exportIndex);
+        ExportIndexState state = exportIndex->read_state();
+        datasetIdx = state.nextSample;
+        // the game which doesn't fit completely anymore is cut like for a single writer
+        numberStored = min(pendingSamples, numberSamples - min(datasetIdx, numberSamples));
+        startIndicesOffset = state.nextGame;
+        size_t gameStart = 0;
+        for (const unique_ptr<ExportGame>& game : pendingGames) {
+            if (gameStart >= numberStored) {
+                break;
+            }
+            pendingStartIndices.push_back(int32_t(datasetIdx + gameStart));
+            gameStart += game->numberSamples;
+        }
+        state.nextSample += numberStored;
+        state.nextGame += pendingStartIndices.size();
+        // the last entry marks the end of the data and is overwritten by the next writer
+        if (numberStored != 0 && state.nextGame < numberSamples) {
+            pendingStartIndices.push_back(int32_t(state.nextSample));
+        }
+        exportIndex->write_state(state);
+        reservedSamples = state.nextSample;
+
+        // the chunks of "start_indices" are shared between the writers, so they are only written while holding the lock
+        write_start_indices();
+        // the same holds for the first and the last chunk of the reserved range, which may contain samples of other writers
+        const size_t endIdx = datasetIdx + numberStored;
+        headEnd = min((datasetIdx + chunkSize - 1) / chunkSize * chunkSize, endIdx);
+        tailBegin = max(endIdx / chunkSize * chunkSize, headEnd);
+        write_samples(0, headEnd - datasetIdx, datasetIdx);
+        write_samples(tailBegin - datasetIdx, numberStored, tailBegin);
+    }
+    // the complete chunks in between are exclusively written by this exporter
+    write_samples(headEnd - datasetIdx, tailBegin - datasetIdx, headEnd);
+
+    discardedSamples += pendingSamples - numberStored;
+    pendingGames.clear();
+    pendingSamples = 0;
+}
+
+void TrainDataExporter::write_samples(size_t begin, size_t end, size_t datasetIdx)
+{
+    if (begin >= end) {
+        return;
+    }
+    z5::types::ShapeType offset = { datasetIdx };
+    z5::types::ShapeType offsetPlanes = { datasetIdx, 0, 0, 0 };
+    z5::types::ShapeType offsetPolicy = { datasetIdx, 0 };
+    const auto samples = xt::range(begin, end);
+    z5::multiarray::writeSubarray<int16_t>(dx, xt::view(chunkX, samples, xt::all(), xt::all(), xt::all()), offsetPlanes.begin());
+    z5::multiarray::writeSubarray<int16_t>(dValue, xt::view(chunkValue, samples), offset.begin());
+    z5::multiarray::writeSubarray<float>(dbestMoveQ, xt::view(chunkBestMoveQ, samples), offset.begin());
+    z5::multiarray::writeSubarray<float>(dPolicy, xt::view(chunkPolicy, samples, xt::all()), offsetPolicy.begin());
+}
+
+void TrainDataExporter::join_shared_dataset()
+{
+    bool waiting = false;
+    while (true) {
+        {
+            lock_guard<ExportIndex> lock(*exportIndex);
+            z5::filesystem::handle::File file(fileName);
+            ExportIndexState state = exportIndex->read_state();
+            const bool firstWriter = !exportIndex->has_active_writers();
+            // without any active writer, only the index of an incomplete data set is continued.
+            // A full or inconsistent index has been left over by a previous run, e.g. if renaming the data set failed.
+            if (firstWriter && (!file.exists() || state.nextSample >= numberSamples || state.nextGame > numberSamples)) {
+                state = ExportIndexState();
+                exportIndex->write_state(state);
+            }
+            if (state.nextSample < numberSamples) {
+                if (!file.exists()) {
+                    create_new_dataset_file(file);
+                }
+                else {
+                    if (firstWriter && state.nextSample == 0) {
+                        cout << "Warning: Export file already exists. It will be overwritten" << endl;
+                    }
+                    open_dataset_from_file(file);
+                }
+                exportIndex->register_writer();
+                reservedSamples = state.nextSample;
+                return;
+            }
+        }
+        // the data set is full, but the other writers haven't finished their last games yet
+        if (!waiting) {
+            info_string("Waiting until the shared export file has been completed by the other writers");
+            waiting = true;
+        }
+        this_thread::sleep_for(chrono::seconds(1));
+    }
+}
+
+void TrainDataExporter::leave_shared_dataset()
+{
+    lock_guard<ExportIndex> lock(*exportIndex);
+    exportIndex->unregister_writer();
+    if (completedFileName.empty() || exportIndex->read_state().nextSample < numberSamples || exportIndex->has_active_writers()) {
+        return;
+    }
+    if (rename(fileName.c_str(), completedFileName.c_str()) != 0) {
+        cout << "Warning: Unable to rename the completed export file " << fileName << " to " << completedFileName
+             << ": " << strerror(errno) << endl;
+        return;
+    }
+    // the next writer starts a new data set
+    exportIndex->write_state(ExportIndexState());
+}
+
+void TrainDataExporter::write_chunk(size_t numberSamples)
+{
+    // chunkStartIdx is always a multiple of chunkSize, so complete chunks are written without reading them first
+    z5::types::ShapeType offset = { chunkStartIdx };
+    z5::types::ShapeType offsetPlanes = { chunkStartIdx, 0, 0, 0 };
+    z5::types::ShapeType offsetPolicy = { chunkStartIdx, 0 };
+    if (numberSamples == chunkSize) {
+        z5::multiarray::writeSubarray<int16_t>(dx, chunkX, offsetPlanes.begin());
+        z5::multiarray::writeSubarray<int16_t>(dValue, chunkValue, offset.begin());
+        z5::multiarray::writeSubarray<float>(dbestMoveQ, chunkBestMoveQ, offset.begin());
+        z5::multiarray::writeSubarray<float>(dPolicy, chunkPolicy, offsetPolicy.begin());
+    }
+    else {
+        write_samples(0, numberSamples, chunkStartIdx);
+    }
+    chunkStartIdx += chunkSize;
+    chunkFill = 0;
+}
+
+void TrainDataExporter::write_start_indices()
+{
+    if (pendingStartIndices.empty()) {
+        return;
+    }
+    // gameStartIdx
+    // write value to roi
+    z5::types::ShapeType offsetStartIdx = { startIndicesOffset };
+    xt::xarray<int32_t> arrayGameStartIdx = xt::adapt(pendingStartIndices, { pendingStartIndices.size() });
+    z5::multiarray::writeSubarray<int32_t>(dStartIndex, arrayGameStartIdx, offsetStartIdx.begin());
+    startIndicesOffset += pendingStartIndices.size();
+    pendingStartIndices.clear();
+}
+
+TrainDataExporter::TrainDataExporter(const string& fileName, size_t numberChunks, size_t chunkSize, bool compactExport, bool multiWriter,
+                                     const string& completedFileName, size_t maxGameLength):
     numberChunks(numberChunks),
     chunkSize(chunkSize),
     numberSamples(numberChunks * chunkSize),
+    gameCapacity(0),
     firstMove(true),
     gameIdx(0),
     startIdx(0),
-    curSampleIdx(0)
+    curSampleIdx(0),
+    stopWriter(false),
+    chunkStartIdx(0),
+    chunkFill(0),
+    startIndicesOffset(0),
+    compactExport(compactExport),
+    compactBytes(0),
+    compactSamples(0),
+    pendingSamples(0),
+    reservedSamples(0),
+    discardedSamples(0),
+    fileName(fileName),
+    completedFileName(completedFileName)
 {
-    // get handle to a File on the filesystem
-    z5::filesystem::handle::File file(fileName);
-
-    if (file.exists()) {
-        cout << "Warning: Export file already exists. It will be overwritten" << endl;
-        open_dataset_from_file(file);
+    if (compactExport) {
+        string fileNameCompact = fileName;
+        const size_t extensionPos = fileNameCompact.rfind(".zarr");
+        if (extensionPos != string::npos) {
+            fileNameCompact.erase(extensionPos);
+        }
+        compactFile.open(fileNameCompact + ".bin", ios::binary | ios::trunc);
+        write_compact_header(compactFile);
+    }
+    else if (multiWriter) {
+        exportIndex = make_unique<ExportIndex>(fileName + ".index");
+        join_shared_dataset();
     }
     else {
-        create_new_dataset_file(file);
+        // get handle to a File on the filesystem
+        z5::filesystem::handle::File file(fileName);
+
+        if (file.exists()) {
+            cout << "Warning: Export file already exists. It will be overwritten" << endl;
+            open_dataset_from_file(file);
+        }
+        else {
+            create_new_dataset_file(file);
+        }
+    }
+    allocate_game_buffers(max(maxGameLength, size_t(1)));
+
+    chunkX = xt::xarray<int16_t>::from_shape({ chunkSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH });
+    chunkValue = xt::xarray<int16_t>::from_shape({ chunkSize });
+    chunkPolicy = xt::xarray<float>::from_shape({ chunkSize, NB_LABELS });
+    chunkBestMoveQ = xt::xarray<float>::from_shape({ chunkSize });
+    if (exportIndex == nullptr) {
+        // the first game starts at index 0
+        pendingStartIndices.push_back(0);
     }
+    writerThread = thread(&TrainDataExporter::run_writer, this);
+}
+
+TrainDataExporter::~TrainDataExporter()
+{
+    close();
 }
 
 size_t TrainDataExporter::get_number_samples() const
@@ -122,7 +438,15 @@ size_t TrainDataExporter::get_number_samples() const
 
 bool TrainDataExporter::is_file_full()
 {
-    return startIdx >= numberSamples;
+    return startIdx >= numberSamples || reservedSamples >= numberSamples;
+}
+
+float TrainDataExporter::get_fill_level()
+{
+    if (exportIndex != nullptr) {
+        return min(1.0f, float(reservedSamples) / numberSamples);
+    }
+    return min(1.0f, float(startIdx) / numberSamples);
 }
 
 void TrainDataExporter::new_game()
@@ -131,24 +455,12 @@ void TrainDataExporter::new_game()
     curSampleIdx = 0;
 }
 
-void TrainDataExporter::save_planes(const Board *pos)
+void TrainDataExporter::save_planes(const float* inputPlanes)
 {
     // x / plane representation
-    float inputPlanes[NB_VALUES_TOTAL];
-    board_to_planes(pos, pos->number_repetitions(), false, inputPlanes);
-    // write array to roi
-    xt::xarray<int16_t>::shape_type planesShape = { 1, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    xt::xarray<int16_t> planes(planesShape);
+    int16_t* planes = gameX.data() + curSampleIdx * NB_VALUES_TOTAL;
     for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
-        planes.data()[idx] = int16_t(inputPlanes[idx]);
-    }
-
-    if (firstMove) {
-        gameX = planes;
-    }
-    else {
-        // concatenate the sample to array for the current game
-        gameX = xt::concatenate(xtuple(gameX, planes));
+        planes[idx] = int16_t(inputPlanes[idx]);
     }
 }
 
@@ -156,8 +468,8 @@ void TrainDataExporter::save_policy(const vector<Move>& legalMoves, const Dynami
 {
     assert(legalMoves.size() == policyProbSmall.size());
 
-    xt::xarray<float>::shape_type shapePolicy = { 1, NB_LABELS };
-    xt::xarray<float> policy(shapePolicy, 0);
+    float* policy = gamePolicy.data() + curSampleIdx * NB_LABELS;
+    fill(policy, policy + NB_LABELS, 0.0f);
 
     for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
         size_t policyIdx;
@@ -169,23 +481,27 @@ void TrainDataExporter::save_policy(const vector<Move>& legalMoves, const Dynami
         }
         policy[policyIdx] = policyProbSmall[idx];
     }
-
-    if (firstMove) {
-        gamePolicy = policy;
-    }
-    else {
-        // concatenate the sample to array for the current game
-        gamePolicy = xt::concatenate(xtuple(gamePolicy, policy));
-    }
 }
 
-void TrainDataExporter::save_start_idx()
+void TrainDataExporter::allocate_game_buffers(size_t capacity)
 {
-    // gameStartIdx
-    // write value to roi
-    z5::types::ShapeType offsetStartIdx = { gameIdx };
-    xt::xarray<int32_t> arrayGameStartIdx({ 1 }, int32_t(startIdx));
-    z5::multiarray::writeSubarray<int32_t>(dStartIndex, arrayGameStartIdx, offsetStartIdx.begin());
+    xt::xarray<int16_t> newX = xt::xarray<int16_t>::from_shape({ capacity, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH });
+    xt::xarray<int16_t> newValue = xt::xarray<int16_t>::from_shape({ capacity });
+    xt::xarray<float> newPolicy = xt::xarray<float>::from_shape({ capacity, NB_LABELS });
+    xt::xarray<float> newBestMoveQ = xt::xarray<float>::from_shape({ capacity });
+
+    // keep the samples of the current game
+    if (curSampleIdx != 0) {
+        copy_n(gameX.data(), curSampleIdx * NB_VALUES_TOTAL, newX.data());
+        copy_n(gameValue.data(), curSampleIdx, newValue.data());
+        copy_n(gamePolicy.data(), curSampleIdx * NB_LABELS, newPolicy.data());
+        copy_n(gameBestMoveQ.data(), curSampleIdx, newBestMoveQ.data());
+    }
+    gameX = move(newX);
+    gameValue = move(newValue);
+    gamePolicy = move(newPolicy);
+    gameBestMoveQ = move(newBestMoveQ);
+    gameCapacity = capacity;
 }
 
 void TrainDataExporter::open_dataset_from_file(const z5::filesystem::handle::File& file)
@@ -211,18 +527,17 @@ void TrainDataExporter::create_new_dataset_file(const z5::filesystem::handle::Fi
     dValue = z5::createDataset(file, "y_value", "int16", { numberSamples }, { chunkSize });
     dPolicy = z5::createDataset(file, "y_policy", "float32", { numberSamples, NB_LABELS }, { chunkSize, NB_LABELS });
     dbestMoveQ = z5::createDataset(file, "y_best_move_q", "float32", { numberSamples }, { chunkSize });
-
-    save_start_idx();
 }
 
 void TrainDataExporter::apply_result_to_value(Result result)
 {
     // value
+    auto value = xt::view(gameValue, xt::range(0, curSampleIdx));
     if (result == BLACK_WIN) {
-        gameValue *= -1;
+        value *= -1;
     }
     else if (result == DRAWN) {
-        gameValue *= 0;
+        value *= 0;
     }
 }
 
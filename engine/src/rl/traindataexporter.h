@@ -30,9 +30,17 @@
 
 #ifdef USE_RL
 #include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <atomic>
 
 #include "nlohmann/json.hpp"
 #include "xtensor/xarray.hpp"
+#include "xtensor/xview.hpp"
+#include "xtensor/xadapt.hpp"
 #include "z5/factory.hxx"
 #include "z5/filesystem/handle.hxx"
 #include "z5/multiarray/xtensor_access.hxx"
@@ -46,6 +54,22 @@
 #include "../domain/crazyhouse/constants.h"
 #include "../node.h"
 #include "../evalinfo.h"
+#include "compactsample.h"
+#include "exportindex.h"
+
+/**
+ * @brief The ExportGame struct holds the samples of a finished game until they are written by the writer thread
+ */
+struct ExportGame
+{
+    vector<int16_t> x;
+    vector<int16_t> value;
+    vector<float> policy;
+    vector<float> bestMoveQ;
+    size_t numberSamples;
+    // sample index at which the next game will start
+    int32_t nextStartIdx;
+};
 
 class TrainDataExporter
 {
@@ -59,10 +83,12 @@ private:
     std::unique_ptr<z5::Dataset> dPolicy;
     std::unique_ptr<z5::Dataset> dbestMoveQ;
 
+    // per game buffers which are preallocated for gameCapacity samples and only grow for very long games
     xt::xarray<int16_t> gameX;
     xt::xarray<int16_t> gameValue;
     xt::xarray<float> gamePolicy;
     xt::xarray<float> gameBestMoveQ;
+    size_t gameCapacity;
     bool firstMove;
 
     // current number of games - 1
@@ -71,11 +97,51 @@ private:
     size_t startIdx;
     size_t curSampleIdx;
 
+    // finished games are written asynchronously by the writer thread in whole chunks of chunkSize samples.
+    // For multiple writers only the chunks in between the first and the last chunk of a reservation are written as a whole,
+    // the first and the last chunk are shared with other writers and are read and rewritten (see commit_games()).
+    thread writerThread;
+    mutex queueMtx;
+    condition_variable queueCondition;
+    deque<unique_ptr<ExportGame>> exportQueue;
+    bool stopWriter;
+
+    // samples of the chunk which is currently accumulated by the writer thread (only accessed by the writer thread).
+    // For multiple writers the buffers hold all pending games and grow if necessary.
+    xt::xarray<int16_t> chunkX;
+    xt::xarray<int16_t> chunkValue;
+    xt::xarray<float> chunkPolicy;
+    xt::xarray<float> chunkBestMoveQ;
+    size_t chunkStartIdx;
+    size_t chunkFill;
+    // start indices which haven't been written yet, beginning at game index startIndicesOffset
+    vector<int32_t> pendingStartIndices;
+    size_t startIndicesOffset;
+
+    // the samples are written in the compact format (see compactsample.h) instead of the zarr data set
+    bool compactExport;
+    ofstream compactFile;
+    vector<uint8_t> encodedGame;
+    size_t compactBytes;
+    size_t compactSamples;
+
+    // shared index which reserves the samples if several exporters write into the same data set (nullptr for a single writer)
+    unique_ptr<ExportIndex> exportIndex;
+    // finished games which haven't been committed to the shared data set yet (only used for multiple writers)
+    vector<unique_ptr<ExportGame>> pendingGames;
+    size_t pendingSamples;
+    // number of reserved samples of the shared data set as of the last reservation of this exporter
+    atomic<size_t> reservedSamples;
+    size_t discardedSamples;
+    string fileName;
+    // the last writer renames the completed shared data set to this file name
+    string completedFileName;
+
     /**
      * @brief export_planes Exports the board in plane representation (x)
-     * @param pos Board position to export
+     * @param inputPlanes Plane representation of the board position to export
      */
-    void save_planes(const Board *pos);
+    void save_planes(const float* inputPlanes);
 
     /**
      * @brief save_policy Saves the policy (e.g. mctsPolicy) to the matrix
@@ -101,9 +167,70 @@ private:
     void save_side_to_move(Color col);
 
     /**
-     * @brief save_start_idx Saves the current starting index where the next game starts to the game array
+     * @brief allocate_game_buffers Allocates the per game buffers for the given number of samples.
+     * The samples which have already been saved for the current game are kept.
+     * @param capacity Number of samples which can be stored without reallocation
+     */
+    void allocate_game_buffers(size_t capacity);
+
+    /**
+     * @brief run_writer Main loop of the writer thread which receives the finished games from the export queue
+     */
+    void run_writer();
+
+    /**
+     * @brief write_compact_game Encodes a finished game in the compact format and appends it to the export file
+     * @param game Finished game
+     */
+    void write_compact_game(const ExportGame& game);
+
+    /**
+     * @brief add_game_to_chunk Copies the samples of a finished game into the current chunk and writes every completed chunk
+     * @param game Finished game
+     */
+    void add_game_to_chunk(const ExportGame& game);
+
+    /**
+     * @brief write_chunk Writes the first numberSamples samples of the current chunk to the data set and starts a new chunk
+     * @param numberSamples Number of samples to write, equals chunkSize apart from the last chunk when the exporter is closed
+     */
+    void write_chunk(size_t numberSamples);
+
+    /**
+     * @brief commit_games Reserves a continuous range of the shared data set for the pending games, writes their start indices
+     * and finally their samples. Games which don't fit anymore are discarded, apart from the first part of the game
+     * which fills the data set. Only used if multiple writers share the data set.
+     * The reserved range usually doesn't start and end at chunk boundaries, so the first and the last chunk are partially written
+     * while holding the lock of the index, which makes z5 read and rewrite them. Reserving whole chunks instead would leave gaps
+     * of unused samples between the games of different writers.
+     */
+    void commit_games();
+
+    /**
+     * @brief write_samples Writes the samples [begin, end) of the chunk buffers to the data set
+     * @param begin First sample of the chunk buffers
+     * @param end Sample after the last sample of the chunk buffers
+     * @param datasetIdx Index in the data set of the first sample
+     */
+    void write_samples(size_t begin, size_t end, size_t datasetIdx);
+
+    /**
+     * @brief join_shared_dataset Registers the exporter as a writer of the shared data set.
+     * The first writer starts a new data set unless the index belongs to an incomplete data set.
+     * If the data set is already full, it waits until the remaining writers have finished it.
+     */
+    void join_shared_dataset();
+
+    /**
+     * @brief leave_shared_dataset Unregisters the exporter. The last writer of a full data set renames it to completedFileName
+     * and resets the index for the next data set.
      */
-    void save_start_idx();
+    void leave_shared_dataset();
+
+    /**
+     * @brief write_start_indices Writes the buffered game start indices to the data set
+     */
+    void write_start_indices();
 
     /**
      * @brief open_dataset_from_file Reads a previously exported training set back into memory
@@ -130,8 +257,19 @@ public:
      * @param numberChunks Defines how many chunks a single file should contain.
      * The product of the number of chunks and its chunk size yields the total number of samples of a file.
      * @param chunkSize Defines the chunk size of a single chunk
+     * @param compactExport If true, the samples are written in the compact format to a ".bin" file
+     * instead of the zarr data set (e.g. "data.zarr" -> "data.bin")
+     * @param multiWriter If true, several exporters (threads or processes) can write into the same zarr data set.
+     * The samples are reserved in whole games through the index file "<fileNameExport>.index".
+     * @param completedFileName Only used for multiple writers: the last writer renames the full data set to this file name,
+     * so it is compressed exactly once (e.g. "data_<device>.zarr")
+     * @param maxGameLength Initial capacity of the per game buffers. The capacity is doubled if a game exceeds it.
      */
-    TrainDataExporter(const string& fileNameExport, size_t numberChunks=200, size_t chunkSize=128);
+    TrainDataExporter(const string& fileNameExport, size_t numberChunks=200, size_t chunkSize=128, bool compactExport=false,
+                      bool multiWriter=false, const string& completedFileName="", size_t maxGameLength=512);
+    ~TrainDataExporter();
+    TrainDataExporter(const TrainDataExporter&) = delete;
+    TrainDataExporter& operator=(const TrainDataExporter&) = delete;
 
     /**
      * @brief export_pos Saves a given board position, policy and Q-value to the specific game arrays
@@ -140,23 +278,48 @@ public:
      */
     void save_sample(const Board *pos, const EvalInfo& eval);
 
+    /**
+     * @brief save_sample Saves a sample based on the already computed plane representation of the board position
+     * @param inputPlanes Plane representation (without normalization) of the current board position
+     * @param eval Filled EvalInfo struct after mcts search
+     * @param sideToMove Side to move of the board position
+     */
+    void save_sample(const float* inputPlanes, const EvalInfo& eval, Color sideToMove);
+
     /**
      * @brief export_game_samples Assigns the game result, (Monte-Carlo value result) to every training sample.
      * The value is inversed after each step and export all training samples of a single game.
+     * The samples are handed over to the writer thread, so the function doesn't wait for disk I/O.
      * @param result Game match result: LOST, DRAW, WON
      */
     void export_game_samples(Result result);
 
+    /**
+     * @brief close Waits until all queued games have been written, writes the remaining incomplete chunk
+     * and stops the writer thread. For the compact format the bytes per sample are reported in comparison to the zarr format.
+     * The function is called by the destructor and may be called multiple times.
+     * No samples must be exported afterwards.
+     */
+    void close();
+
     size_t get_number_samples() const;
 
     /**
-     * @brief is_file_full Returns true if the exported data set contains as many samples as initially specified, else false
+     * @brief is_file_full Returns true if the exported data set contains as many samples as initially specified, else false.
+     * For multiple writers it returns true as soon as all samples of the shared data set have been reserved.
+     * The index isn't read here, the reservations of other writers are only noticed when this exporter commits its games.
      * @return bool
      */
     bool is_file_full();
 
     /**
-     * @brief new_game Sets firstMove to true
+     * @brief get_fill_level Returns the exported fraction of the data set (reserved samples of the shared data set for multiple writers)
+     * @return float in [0, 1]
+     */
+    float get_fill_level();
+
+    /**
+     * @brief new_game Sets firstMove to true and resets the sample index of the per game buffers
      */
     void new_game();
 };
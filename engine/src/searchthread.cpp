@@ -24,6 +24,7 @@
  */
 
 #include "searchthread.h"
+#include <thread>
 #ifdef TENSORRT
 #include "NvInfer.h"
 #include <cuda_runtime_api.h>
@@ -34,9 +35,33 @@
 #include "outputrepresentation.h"
 #include "util/blazeutil.h"
 #include "uci.h"
+#include "util/lockstatistics.h"
+#include "util/tracer.h"
+#include "util/memorystatistics.h"
+#include "util/affinity.h"
+#include "misc.h"
 
 SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSettings, MapWithMutex* mapWithMutex):
-    netBatch(netBatch), isRunning(false), mapWithMutex(mapWithMutex), searchSettings(searchSettings)
+    netBatch(netBatch), isRunning(false), mapWithMutex(mapWithMutex), searchSettings(searchSettings),
+    numaNode(0), bufferNumaNode(-1)
+{
+    allocate_buffers();
+    searchLimits = nullptr;  // will be set by set_search_limits() every time before go()
+    searchBudget = nullptr;  // will be set by set_search_budget() before the first search
+
+    newNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize);
+    newNodeSideToMove = make_unique<FixedVector<Color>>(searchSettings->batchSize);
+    newNodePositions = make_unique<FixedVector<Board*>>(searchSettings->batchSize);
+    transpositionNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize*2);
+    collisionNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize);
+}
+
+SearchThread::~SearchThread()
+{
+    free_buffers();
+}
+
+void SearchThread::allocate_buffers()
 {
     // allocate memory for all predictions and results
 #ifdef TENSORRT
@@ -48,15 +73,9 @@ SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSetting
     valueOutputs = new float[searchSettings->batchSize];
     probOutputs = new float[netBatch->get_policy_output_length()];
 #endif
-    searchLimits = nullptr;  // will be set by set_search_limits() every time before go()
-
-    newNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize);
-    newNodeSideToMove = make_unique<FixedVector<Color>>(searchSettings->batchSize);
-    transpositionNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize*2);
-    collisionNodes = make_unique<FixedVector<Node*>>(searchSettings->batchSize);
 }
 
-SearchThread::~SearchThread()
+void SearchThread::free_buffers()
 {
 #ifdef TENSORRT
     CHECK(cudaFreeHost(inputPlanes));
@@ -69,6 +88,28 @@ SearchThread::~SearchThread()
 #endif
 }
 
+void SearchThread::apply_thread_affinity()
+{
+    int memoryNode = -1;
+    if (searchSettings->searchCpus.empty()) {
+        memoryNode = set_thread_affinity(searchSettings->threadAffinity, numaNode);
+    }
+    else {
+        pin_thread_to_cpus(searchSettings->searchCpus);
+    }
+    if (memoryNode != bufferNumaNode) {
+        // the buffers are reallocated by the pinned thread, so their pages are placed on the memory node
+        free_buffers();
+        allocate_buffers();
+        bufferNumaNode = memoryNode;
+    }
+}
+
+void SearchThread::set_numa_node(size_t value)
+{
+    numaNode = value;
+}
+
 void SearchThread::set_root_node(Node *value)
 {
     rootNode = value;
@@ -79,6 +120,11 @@ void SearchThread::set_search_limits(SearchLimits *s)
     searchLimits = s;
 }
 
+void SearchThread::set_search_budget(SearchBudget* value)
+{
+    searchBudget = value;
+}
+
 bool SearchThread::is_running() const
 {
     return isRunning;
@@ -89,22 +135,35 @@ void SearchThread::set_is_running(bool value)
     isRunning = value;
 }
 
+void SearchThread::set_net_active(bool active)
+{
+    netBatch->set_active(active);
+}
+
 void SearchThread::add_new_node_to_tree(Board* newPos, Node* parentNode, size_t childIdx, bool inCheck)
 {
-    mapWithMutex->mtx.lock();
-    unordered_map<Key, Node*>::const_iterator it = mapWithMutex->hashTable.find(newPos->hash_key());
+    profiled_lock(mapWithMutex->mtx, LOCK_HASH_TABLE);
+    HashTable::const_iterator it = mapWithMutex->hashTable.find(newPos->hash_key());
     mapWithMutex->mtx.unlock();
     if(searchSettings->useTranspositionTable && it != mapWithMutex->hashTable.end() &&
             is_transposition_verified(it, newPos->get_state_info())) {
-        Node *newNode = new Node(*it->second);
+        void* memory = parentNode->allocate_child_memory(childIdx);
+        // the source node is locked because its moves and policy might be restored or sorted at the same time
+        it->second->lock();
+        Node *newNode = memory != nullptr ? new (memory) Node(*it->second) : new Node(*it->second);
+        it->second->unlock();
         parentNode->add_transposition_child_node(newNode, childIdx);
         parentNode->increment_no_visit_idx();
         transpositionNodes->add_element(newNode);
+        ++searchCounters.transpositions;
     }
     else {
         parentNode->increment_no_visit_idx();
         assert(parentNode != nullptr);
-        Node *newNode = new Node(newPos, inCheck, parentNode, childIdx, searchSettings);
+        // siblings are stored next to each other in the child blocks of the parent
+        void* memory = parentNode->allocate_child_memory(childIdx);
+        Node *newNode = memory != nullptr ? new (memory) Node(newPos, inCheck, parentNode, childIdx, searchSettings) :
+                                            new Node(newPos, inCheck, parentNode, childIdx, searchSettings);
         // fill a new board in the input_planes vector
         // we shift the index by NB_VALUES_TOTAL each time
         board_to_planes(newPos, newPos->number_repetitions(), true, inputPlanes+newNodes->size()*NB_VALUES_TOTAL);
@@ -116,6 +175,12 @@ void SearchThread::add_new_node_to_tree(Board* newPos, Node* parentNode, size_t
         // it will later be updated with the evaluation of the NN
         newNodes->add_element(newNode);
         newNodeSideToMove->add_element(newPos->side_to_move());
+        if (searchSettings->compactLeafNodes) {
+            // the copy takes over the StateInfo of the last move, the moves of the leaf are generated from it in set_nn_results_to_child_nodes()
+            // (the previous StateInfos are freed before, but move generation only uses the current one)
+            newNodePositions->add_element(new Board(*newPos));
+            newPos->set_state_info(nullptr);
+        }
     }
 }
 
@@ -142,37 +207,44 @@ Node* get_new_child_to_evaluate(Board* pos, Node* rootNode, size_t& childIdx, No
 
     while (true) {
         currentNode->lock();
-        childIdx = currentNode->select_child_node(searchSettings);
-        currentNode->apply_virtual_loss_to_child(childIdx, searchSettings->virtualLoss);
-
+        childIdx = currentNode->select_child_node(searchSettings, pos);
+        // the child pointer is loaded first, so the cache miss of the child node overlaps with the virtual loss update.
+        // Only the node itself is prefetched, because its node data may be changed by other threads until it is locked.
         Node* nextNode = currentNode->get_child_node(childIdx);
+        prefetch(nextNode);
+        // the move is read under the lock, because expand_policy_tail() of another thread may reallocate the moves afterwards
+        const Move move = currentNode->get_move(childIdx);
+        currentNode->apply_virtual_loss_to_child(childIdx, searchSettings->virtualLoss);
         description.depth++;
         if (nextNode == nullptr) {
             description.isCollision = false;
             description.isTerminal = false;
             currentNode->unlock();
-            inCheck = pos->gives_check(currentNode->get_move(childIdx));
+            inCheck = pos->gives_check(move);
             // this new StateInfo will be freed from memory when 'pos' is freed
-            pos->do_move(currentNode->get_move(childIdx), *(new StateInfo));
+            pos->do_move(move, *(new StateInfo));
+            memoryStatistics.add(MEM_STATE_INFO, sizeof(StateInfo));
             return currentNode;
         }
         if (nextNode->is_terminal()) {
             description.isCollision = false;
             description.isTerminal = true;
             currentNode->unlock();
-            pos->do_move(currentNode->get_move(childIdx), *(new StateInfo));
+            pos->do_move(move, *(new StateInfo));
+            memoryStatistics.add(MEM_STATE_INFO, sizeof(StateInfo));
             return currentNode;
         }
         if (!nextNode->has_nn_results()) {
             description.isCollision = true;
             description.isTerminal = false;
             currentNode->unlock();
-            pos->do_move(currentNode->get_move(childIdx), *(new StateInfo));
+            pos->do_move(move, *(new StateInfo));
+            memoryStatistics.add(MEM_STATE_INFO, sizeof(StateInfo));
             return currentNode;
         }
         currentNode->unlock();
         states->emplace_back();
-        pos->do_move(currentNode->get_move(childIdx), states->back());
+        pos->do_move(move, states->back());
         currentNode = nextNode;
     }
 }
@@ -190,13 +262,81 @@ size_t SearchThread::get_tb_hits() const
 void SearchThread::reset_tb_hits()
 {
     tbHits = 0;
+    searchCounters.reset();
+}
+
+const SearchCounters& SearchThread::get_search_counters() const
+{
+    return searchCounters;
+}
+
+void SearchThread::open_perf_counters()
+{
+    perfCounters.reset();
+    if (searchSettings->usePerfCounters) {
+        perfCounters = make_unique<PerfCounters>();
+        if (!perfCounters->is_valid()) {
+            info_string("Unable to open the hardware performance counters");
+            perfCounters.reset();
+        }
+    }
+}
+
+void SearchThread::close_perf_counters()
+{
+    if (perfCounters != nullptr) {
+        perfCounters->close();
+        perfCounters->get_perf_values().nodes = searchCounters.nnSamples + searchCounters.transpositions;
+    }
+}
+
+PerfValues SearchThread::get_perf_values() const
+{
+    if (perfCounters == nullptr) {
+        return PerfValues();
+    }
+    return perfCounters->get_perf_values();
+}
+
+SearchCounters::SearchCounters()
+{
+    reset();
+}
+
+void SearchCounters::reset()
+{
+    collisions = 0;
+    transpositions = 0;
+    terminalHits = 0;
+    nnBatches = 0;
+    nnSamples = 0;
+    nnBatchSlots = 0;
+}
+
+SearchCounters& SearchCounters::operator+=(const SearchCounters& other)
+{
+    collisions += other.collisions;
+    transpositions += other.transpositions;
+    terminalHits += other.terminalHits;
+    nnBatches += other.nnBatches;
+    nnSamples += other.nnSamples;
+    nnBatchSlots += other.nnBatchSlots;
+    return *this;
 }
 
-void fill_nn_results(size_t batchIdx, bool is_policy_map, const float* valueOutputs, const float* probOutputs, Node *node, size_t& tbHits, Color sideToMove, const SearchSettings* searchSettings)
+void fill_nn_results(size_t batchIdx, bool is_policy_map, const float* valueOutputs, const float* probOutputs, Node *node, Board* pos, size_t& tbHits, Color sideToMove, const SearchSettings* searchSettings)
 {
+    node->generate_deferred_moves(pos);
+    if (node->is_terminal()) {
+        // a leaf without legal moves is only detected after its moves have been generated
+        return;
+    }
     node->set_probabilities_for_moves(get_policy_data_batch(batchIdx, probOutputs, is_policy_map), get_current_move_lookup(sideToMove));
     node_post_process_policy(node, searchSettings->nodePolicyTemperature, is_policy_map, searchSettings);
     node_assign_value(node, valueOutputs, tbHits, batchIdx);
+    if (searchSettings->compactLeafNodes) {
+        node->compress_policy();
+    }
     node->enable_has_nn_results();
 }
 
@@ -205,13 +345,23 @@ void SearchThread::set_nn_results_to_child_nodes()
     size_t batchIdx = 0;
     for (auto node: *newNodes) {
         if (!node->is_terminal()) {
-            fill_nn_results(batchIdx, netBatch->is_policy_map(), valueOutputs, probOutputs, node, tbHits, newNodeSideToMove->get_element(batchIdx), searchSettings);
+            Board* pos = searchSettings->compactLeafNodes ? newNodePositions->get_element(batchIdx) : nullptr;
+            fill_nn_results(batchIdx, netBatch->is_policy_map(), valueOutputs, probOutputs, node, pos, tbHits, newNodeSideToMove->get_element(batchIdx), searchSettings);
         }
         ++batchIdx;
-        mapWithMutex->mtx.lock();
-        mapWithMutex->hashTable.insert({node->hash_key(), node});
+        profiled_lock(mapWithMutex->mtx, LOCK_HASH_TABLE);
+        const size_t bucketCount = mapWithMutex->hashTable.bucket_count();
+        if (mapWithMutex->hashTable.insert({node->hash_key(), node}).second) {
+            memoryStatistics.add(MEM_HASH_TABLE, hash_table_entry_bytes<HashTable>() +
+                                 (int64_t(mapWithMutex->hashTable.bucket_count()) - int64_t(bucketCount)) * sizeof(void*));
+        }
         mapWithMutex->mtx.unlock();
     }
+    for (Board* pos : *newNodePositions) {
+        delete pos;
+        memoryStatistics.add(MEM_STATE_INFO, -int64_t(sizeof(StateInfo)));
+    }
+    newNodePositions->reset_idx();
 }
 
 void SearchThread::backup_value_outputs()
@@ -229,9 +379,9 @@ void SearchThread::backup_collisions()
     collisionNodes->reset_idx();
 }
 
-bool SearchThread::nodes_limits_ok()
+bool SearchThread::search_limits_ok()
 {
-    return searchLimits->nodes == 0 || (rootNode->get_visits() - rootNode->get_terminal_visits() < searchLimits->nodes);
+    return !searchBudget->is_exhausted();
 }
 
 bool SearchThread::is_root_node_unsolved()
@@ -246,48 +396,89 @@ void SearchThread::create_mini_batch()
     NodeDescription description;
     size_t childIdx;
     size_t numTerminalNodes = 0;
+    // every new node and transposition is a playout, a single batch is claimed at most,
+    // so the other threads still get playouts under small node limits
+    const size_t claimedPlayouts = searchBudget->claim(searchSettings->batchSize);
+    if (claimedPlayouts == 0) {
+        // the remaining playouts are claimed by batches of other threads which haven't been settled yet,
+        // a shared batch mustn't wait for this thread in the meantime
+        set_net_active(false);
+        searchBudget->wait_for_playouts();
+        set_net_active(true);
+        return;
+    }
 
     while (!newNodes->is_full() &&
            !collisionNodes->is_full() &&
            !transpositionNodes->is_full() &&
-           numTerminalNodes < TERMINAL_NODE_CACHE) {
+           numTerminalNodes < TERMINAL_NODE_CACHE &&
+           newNodes->size() + transpositionNodes->size() < claimedPlayouts) {
 
+        switch_perf_phase(PHASE_SELECTION);
         Board newPos = Board(*rootPos);
         bool inCheck;
         parentNode = get_new_child_to_evaluate(&newPos, rootNode, childIdx, description, inCheck, states, searchSettings);
 
         if(description.isTerminal) {
             ++numTerminalNodes;
+            ++searchCounters.terminalHits;
             parentNode->backup_value(childIdx, -parentNode->get_child_node(childIdx)->get_value(), searchSettings->virtualLoss);
         }
         else if (description.isCollision) {
             // store a pointer to the collision node in order to revert the virtual loss of the forward propagation
             collisionNodes->add_element(parentNode->get_child_node(childIdx));
+            ++searchCounters.collisions;
         }
         else {
+            switch_perf_phase(PHASE_ENCODING);
             add_new_node_to_tree(&newPos, parentNode, childIdx, inCheck);
         }
+        // the StateInfo of the last move is freed together with newPos unless it has been kept for a new leaf
+        if (newPos.get_state_info() != nullptr) {
+            memoryStatistics.add(MEM_STATE_INFO, -int64_t(sizeof(StateInfo)));
+        }
     }
+    searchBudget->settle(claimedPlayouts, newNodes->size() + transpositionNodes->size());
 }
 
 void SearchThread::thread_iteration()
 {
-    create_mini_batch();
+    {
+        TraceSpan span("create_mini_batch");
+        create_mini_batch();
+    }
     if (newNodes->size() != 0) {
-        netBatch->predict(inputPlanes, valueOutputs, probOutputs);
+        {
+            TraceSpan span("predict");
+            switch_perf_phase(PHASE_INFERENCE);
+            netBatch->predict_positions(inputPlanes, valueOutputs, probOutputs, newNodes->size());
+        }
+        TraceSpan span("set_nn_results");
+        switch_perf_phase(PHASE_BACKUP);
         set_nn_results_to_child_nodes();
+        ++searchCounters.nnBatches;
+        searchCounters.nnSamples += newNodes->size();
+        searchCounters.nnBatchSlots += searchSettings->batchSize;
     }
+    TraceSpan span("backup");
+    switch_perf_phase(PHASE_BACKUP);
     backup_value_outputs();
     backup_collisions();
 }
 
 void run_search_thread(SearchThread *t)
 {
+    tracer.set_thread_name("search thread");
+    t->apply_thread_affinity();
     t->set_is_running(true);
     t->reset_tb_hits();
-    while(t->is_running() && t->nodes_limits_ok() && t->is_root_node_unsolved()) {
+    t->open_perf_counters();
+    t->set_net_active(true);
+    while(t->is_running() && t->search_limits_ok() && t->is_root_node_unsolved()) {
         t->thread_iteration();
     }
+    t->set_net_active(false);
+    t->close_perf_counters();
     t->set_is_running(false);
 }
 
@@ -322,7 +513,7 @@ void node_post_process_policy(Node *node, float temperature, bool isPolicyMap, c
     node->apply_temperature_to_prior_policy(temperature);
 }
 
-bool is_transposition_verified(const unordered_map<Key,Node*>::const_iterator& it, const StateInfo* stateInfo) {
+bool is_transposition_verified(const HashTable::const_iterator& it, const StateInfo* stateInfo) {
     return  it->second->has_nn_results() &&
             it->second->plies_from_null() == stateInfo->pliesFromNull &&
             stateInfo->repetition == 0;
@@ -33,16 +33,34 @@
 #include "neuralnetapi.h"
 #include "config/searchlimits.h"
 #include "util/fixedvector.h"
+#include "util/perfcounters.h"
+#include "manager/searchbudget.h"
 
 
 // wrapper for unordered_map with a mutex for thread safe access
 struct MapWithMutex {
     mutex mtx;
-    unordered_map<Key, Node*> hashTable;
+    HashTable hashTable;
     ~MapWithMutex() {
     }
 };
 
+// counters for the different outcomes of the rollouts of a single search thread
+struct SearchCounters {
+    size_t collisions;
+    size_t transpositions;
+    size_t terminalHits;
+    size_t nnBatches;
+    // number of positions which have been evaluated by the neural network
+    size_t nnSamples;
+    // number of available batch entries over all evaluated batches
+    size_t nnBatchSlots;
+
+    SearchCounters();
+    void reset();
+    SearchCounters& operator+=(const SearchCounters& other);
+};
+
 class SearchThread
 {
 private:
@@ -57,6 +75,8 @@ private:
     // list of all node objects which have been selected for expansion
     unique_ptr<FixedVector<Node*>> newNodes;
     unique_ptr<FixedVector<Color>> newNodeSideToMove;
+    // board positions of the new nodes which are kept until their NN results are assigned (only used if searchSettings->compactLeafNodes is set)
+    unique_ptr<FixedVector<Board*>> newNodePositions;
     unique_ptr<FixedVector<Node*>> transpositionNodes;
     unique_ptr<FixedVector<Node*>> collisionNodes;
 
@@ -70,7 +90,21 @@ private:
     MapWithMutex* mapWithMutex;
     SearchSettings* searchSettings;
     SearchLimits* searchLimits;
+    // playouts and deadline which are shared by all search threads
+    SearchBudget* searchBudget;
     size_t tbHits;
+    SearchCounters searchCounters;
+    // NUMA node which is used if searchSettings->threadAffinity is set and the node on which the buffers have been allocated (-1: default)
+    size_t numaNode;
+    int bufferNumaNode;
+    // hardware performance counters which are only created if searchSettings->usePerfCounters is enabled
+    unique_ptr<PerfCounters> perfCounters;
+
+    inline void switch_perf_phase(PerfPhase phase) {
+        if (perfCounters != nullptr) {
+            perfCounters->switch_phase(phase);
+        }
+    }
 
 public:
     /**
@@ -96,11 +130,10 @@ public:
     void thread_iteration();
 
     /**
-     * @brief nodes_limits_ok Checks if the searchLimits based on the amount of nodes to search has been reached.
-     * In the case the number of nodes is set to zero the limit condition is ignored
+     * @brief search_limits_ok Checks if the shared search budget still has playouts left and the deadline hasn't been reached
      * @return bool
      */
-    inline bool nodes_limits_ok();
+    inline bool search_limits_ok();
 
     /**
      * @brief is_root_node_unsolved Checks if the root node result is still unsolved (not a forced win, draw or loss)
@@ -115,12 +148,31 @@ public:
 
     // Getter, setter functions
     void set_search_limits(SearchLimits *s);
+    void set_search_budget(SearchBudget* value);
     Node* get_root_node() const;
     SearchLimits *get_search_limits() const;
     void set_root_node(Node *value);
     bool is_running() const;
     void set_is_running(bool value);
 
+    /**
+     * @brief apply_thread_affinity Pins the calling thread to searchSettings->searchCpus if the cores are partitioned,
+     * otherwise according to searchSettings->threadAffinity,
+     * and reallocates the input and output buffers on the used memory node if it has changed
+     */
+    void apply_thread_affinity();
+
+    /**
+     * @brief set_numa_node Sets the NUMA node of this search thread for the pinned thread affinity modes
+     */
+    void set_numa_node(size_t value);
+
+    /**
+     * @brief set_net_active Informs the network of this thread that the search starts or stops sending requests
+     * @param active True if the search starts
+     */
+    void set_net_active(bool active);
+
     /**
      * @brief add_new_node_to_tree Adds a new node to the search by either creating a new node or duplicating an exisiting node in case of transposition usage
      * @param newPos Board position of the new node
@@ -131,14 +183,37 @@ public:
     void add_new_node_to_tree(Board* newPos, Node* parentNode, size_t childIdx, bool inCheck);
 
     /**
-     * @brief reset_tb_hits Sets the number of table hits to 0
+     * @brief reset_tb_hits Sets the number of table hits and the search counters to 0
      */
     void reset_tb_hits();
 
     void set_root_pos(Board *value);
     size_t get_tb_hits() const;
+    const SearchCounters& get_search_counters() const;
+
+    /**
+     * @brief open_perf_counters Opens the hardware performance counters for the calling thread if enabled in the search settings
+     */
+    void open_perf_counters();
+
+    /**
+     * @brief close_perf_counters Stops the measurement of the hardware performance counters
+     */
+    void close_perf_counters();
+
+    /**
+     * @brief get_perf_values Returns the performance counter values of the last search (all zero if disabled)
+     * @return PerfValues
+     */
+    PerfValues get_perf_values() const;
 
 private:
+    /**
+     * @brief allocate_buffers Allocates the input planes and the network outputs for a full batch
+     */
+    void allocate_buffers();
+    void free_buffers();
+
     /**
      * @brief set_nn_results_to_child_nodes Sets the neural network value evaluation and policy prediction vector for every newly expanded nodes
      */
@@ -182,10 +257,14 @@ Node* get_new_child_to_evaluate(Board* pos, Node* rootNode, size_t& childIdx, No
 
 void backup_values(FixedVector<Node*>* nodes, float virtualLoss);
 
-void fill_nn_results(size_t batchIdx, bool isPolicyMap, const float* valueOutputs, const float* probOutputs, Node *node, size_t& tbHits, Color sideToMove, const SearchSettings* searchSettings);
+/**
+ * @brief fill_nn_results Assigns the NN evaluation of the given batch index to the node
+ * @param pos Board position of the node which is used to generate deferred moves (can be nullptr if the moves haven't been deferred)
+ */
+void fill_nn_results(size_t batchIdx, bool isPolicyMap, const float* valueOutputs, const float* probOutputs, Node *node, Board* pos, size_t& tbHits, Color sideToMove, const SearchSettings* searchSettings);
 void node_post_process_policy(Node *node, float temperature, bool isPolicyMap, const SearchSettings* searchSettings);
 void node_assign_value(Node *node, const float* valueOutputs, size_t& tbHits, size_t batchIdx);
 
-bool is_transposition_verified(const unordered_map<Key,Node*>::const_iterator& it, const StateInfo* stateInfo);
+bool is_transposition_verified(const HashTable::const_iterator& it, const StateInfo* stateInfo);
 
 #endif // SEARCHTHREAD_H
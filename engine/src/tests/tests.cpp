@@ -28,6 +28,9 @@
 #ifdef BUILD_TESTS
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <thread>
+#include <atomic>
 #include "catch.hpp"
 #include "uci.h"
 #include "../util/sfutil.h"
@@ -35,6 +38,23 @@
 #include "thread.h"
 #include "../domain/crazyhouse/constants.h"
 #include "../domain/crazyhouse/inputrepresentation.h"
+#include "../rl/compactsample.h"
+#include "../manager/searchbudget.h"
+#include "../util/hugepages.h"
+#include "../util/blazeutil.h"
+#include "../node.h"
+#include "../agents/config/searchsettings.h"
+#include "../nn/sharedbatchapi.h"
+#include "../agents/mctsagent.h"
+#include "../manager/statesmanager.h"
+#include "../manager/treemanager.h"
+#include "../util/memorystatistics.h"
+#include "../rl/tournamentresult.h"
+#include <fstream>
+#ifdef USE_RL
+#include "../rl/openingpool.h"
+#endif
+#include <set>
 using namespace Catch::literals;
 using namespace std;
 
@@ -174,6 +194,673 @@ TEST_CASE("Draw_by_insufficient_material"){
     REQUIRE(pos.draw_by_insufficient_material() == false);
 }
 
+TEST_CASE("Compact_Sample_Round_Trip"){
+    init();
+    Board pos;
+    auto uiThread = make_shared<Thread>(0);
+    StateListPtr states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(StartFENs[CHESS_VARIANT], false, CHESS_VARIANT, &states->back(), uiThread.get());
+    apply_moves_to_board({"e2e4", "e7e5", "g1f3"}, pos, states);
+
+    float inputPlanes[NB_VALUES_TOTAL];
+    board_to_planes(&pos, pos.number_repetitions(), false, inputPlanes);
+    vector<int16_t> planes(NB_VALUES_TOTAL);
+    for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
+        planes[idx] = int16_t(inputPlanes[idx]);
+    }
+    // a non-binary plane must be stored densely
+    planes[5] = 3;
+    vector<float> policy(NB_LABELS, 0.0f);
+    policy[0] = 0.25f;
+    policy[42] = 0.7f;
+    policy[NB_LABELS-1] = 0.05f;
+
+    stringstream stream;
+    vector<uint8_t> encodedSamples;
+    encode_compact_sample(planes.data(), policy.data(), -1, 0.3f, encodedSamples);
+    encode_compact_sample(planes.data(), policy.data(), 1, -0.5f, encodedSamples);
+    REQUIRE(encodedSamples.size() < dense_sample_bytes());
+    write_compact_header(stream);
+    write_compact_game(stream, encodedSamples, 2);
+
+    DecodedGame game;
+    REQUIRE(read_compact_header(stream) == true);
+    REQUIRE(read_compact_game(stream, game) == COMPACT_GAME_READ);
+    REQUIRE(game.numberSamples == 2);
+    REQUIRE(equal(planes.begin(), planes.end(), game.x.begin()));
+    REQUIRE(equal(planes.begin(), planes.end(), game.x.begin() + NB_VALUES_TOTAL));
+    REQUIRE(equal(policy.begin(), policy.end(), game.policy.begin() + NB_LABELS));
+    REQUIRE(game.value[0] == -1);
+    REQUIRE(game.value[1] == 1);
+    REQUIRE(game.bestMoveQ[0] == 0.3f);
+    REQUIRE(game.bestMoveQ[1] == -0.5f);
+    REQUIRE(read_compact_game(stream, game) == COMPACT_END_OF_FILE);
+
+    // truncated files and inconsistent length fields are detected
+    const string data = stream.str();
+    const size_t headerBytes = data.size() - 2 * sizeof(uint32_t) - encodedSamples.size();
+    for (size_t truncatedBytes : {size_t(1), encodedSamples.size() / 2, encodedSamples.size() + 4}) {
+        stringstream truncatedStream(data.substr(0, data.size() - truncatedBytes));
+        REQUIRE(read_compact_header(truncatedStream) == true);
+        REQUIRE(read_compact_game(truncatedStream, game) == COMPACT_CORRUPT);
+    }
+    string corruptData = data;
+    const uint32_t numberSamples = 3;
+    corruptData.replace(headerBytes, sizeof(uint32_t), reinterpret_cast<const char*>(&numberSamples), sizeof(uint32_t));
+    stringstream corruptStream(corruptData);
+    REQUIRE(read_compact_header(corruptStream) == true);
+    REQUIRE(read_compact_game(corruptStream, game) == COMPACT_CORRUPT);
+}
+
+TEST_CASE("Search_Budget_Overshoot"){
+    // every thread claims batches and uses only a part of them like batches with collisions and terminal nodes
+    const size_t nodeLimit = 10007;
+    SearchBudget budget;
+    budget.reset(nodeLimit, 0);
+    atomic<size_t> usedPlayouts(0);
+    vector<thread> threads;
+    for (size_t threadIdx = 0; threadIdx < 8; ++threadIdx) {
+        threads.emplace_back([&budget, &usedPlayouts, threadIdx]() {
+            size_t iteration = threadIdx;
+            while (!budget.is_exhausted()) {
+                const size_t claimed = budget.claim(48);
+                const size_t used = claimed - (claimed != 0 && ++iteration % 3 == 0 ? claimed / 2 : 0);
+                usedPlayouts += used;
+                budget.settle(claimed, used);
+            }
+        });
+    }
+    for (thread& curThread : threads) {
+        curThread.join();
+    }
+    REQUIRE(usedPlayouts == nodeLimit);
+    REQUIRE(budget.claim(1) == 0);
+
+    // a claimed batch keeps the budget alive until it is settled and its unused playouts can be claimed again
+    budget.reset(10, 0);
+    const size_t claimed = budget.claim(48);
+    REQUIRE(claimed == 10);
+    REQUIRE(budget.is_exhausted() == false);
+    budget.settle(claimed, 4);
+    REQUIRE(budget.is_exhausted() == false);
+    REQUIRE(budget.claim(48) == 6);
+    budget.settle(6, 6);
+    REQUIRE(budget.is_exhausted() == true);
+
+    // the deadline is checked at every claim, so the first claim after the deadline fails
+    const size_t movetimeMS = 20;
+    const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    budget.reset(0, movetimeMS);
+    while (budget.claim(1) != 0) {
+        this_thread::sleep_for(chrono::microseconds(100));
+    }
+    const size_t elapsedMS = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - startTime).count();
+    REQUIRE(elapsedMS >= movetimeMS);
+    REQUIRE(budget.is_exhausted() == true);
+    REQUIRE(budget.claim(1) == 0);
+
+    // extending the deadline resumes the search, a stop ends it immediately
+    budget.extend_deadline(1000);
+    REQUIRE(budget.claim(1) == 1);
+    budget.stop();
+    REQUIRE(budget.claim(1) == 0);
+}
+
+TEST_CASE("Huge_Page_Allocator"){
+    if (!set_huge_pages(true)) {
+        return;
+    }
+    const size_t numberBlocks = 1000;
+    vector<void*> blocks;
+    set<void*> allocated;
+    for (size_t idx = 0; idx < numberBlocks; ++idx) {
+        blocks.push_back(allocate_tree_memory(100));
+        REQUIRE(reinterpret_cast<uintptr_t>(blocks.back()) % 16 == 0);
+        allocated.insert(blocks.back());
+    }
+    REQUIRE(allocated.size() == numberBlocks);
+
+    // blocks which are freed by a different thread are reused by the allocating thread
+    thread([&blocks]() {
+        for (void* block : blocks) {
+            deallocate_tree_memory(block, 100);
+        }
+    }).join();
+    for (size_t idx = 0; idx < numberBlocks; ++idx) {
+        blocks[idx] = allocate_tree_memory(100);
+        REQUIRE(allocated.count(blocks[idx]) == 1);
+    }
+
+    // blocks of the huge page range are still freed correctly after the huge pages have been disabled
+    set_huge_pages(false);
+    for (void* block : blocks) {
+        deallocate_tree_memory(block, 100);
+    }
+    void* heapBlock = allocate_tree_memory(100);
+    REQUIRE(allocated.count(heapBlock) == 0);
+    deallocate_tree_memory(heapBlock, 100);
+}
+
+TEST_CASE("Half_Precision_Conversion"){
+    // every finite half precision number is converted back without any change
+    for (uint16_t half = 0; half < 0x7c00; ++half) {
+        REQUIRE(float_to_half(half_to_float(half)) == half);
+    }
+    REQUIRE(half_to_float(float_to_half(1.0f)) == 1.0f);
+    REQUIRE(half_to_float(float_to_half(0.0f)) == 0.0f);
+    REQUIRE(half_to_float(float_to_half(1e-9f)) == 0.0f);
+    // the relative error of normal numbers is at most 2^-11
+    for (float prob : {0.9f, 0.33f, 0.01f, 1e-4f}) {
+        REQUIRE(abs(half_to_float(float_to_half(prob)) - prob) <= prob / 2048);
+    }
+}
+
+TEST_CASE("Compact_Leaf_Node_Round_Trip"){
+    init();
+    SearchSettings searchSettings;
+    searchSettings.compactLeafNodes = true;
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateListPtr states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &states->back(), uiThread.get());
+    Node rootNode(&pos, false, nullptr, 0, &searchSettings);
+
+    // the moves of a leaf are only generated together with its policy
+    apply_moves_to_board({"e2e4", "d7d5", "e4d5", "e7e5", "d2d4", "g8f6"}, pos, states);
+    Node leafNode(&pos, false, &rootNode, 0, &searchSettings);
+    REQUIRE(leafNode.has_deferred_moves() == true);
+    REQUIRE(leafNode.get_number_child_nodes() == 0);
+    leafNode.generate_deferred_moves(&pos);
+    REQUIRE(leafNode.has_deferred_moves() == false);
+    const size_t numberChildNodes = MoveList<LEGAL>(pos).size();
+    REQUIRE(leafNode.get_number_child_nodes() == numberChildNodes);
+
+    // every move gets a different prior
+    unordered_map<Move, float> priors;
+    DynamicVector<float>& policy = leafNode.get_policy_prob_small();
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        policy[idx] = float(idx + 1) / (numberChildNodes * (numberChildNodes + 1) / 2);
+        priors[leafNode.get_move(idx)] = policy[idx];
+    }
+    leafNode.compress_policy();
+    REQUIRE(leafNode.is_compressed() == true);
+    REQUIRE(leafNode.get_legal_moves().size() == 0);
+    REQUIRE(leafNode.get_number_child_nodes() == numberChildNodes);
+
+    // the policy is restored on a transposition with a different move history
+    Board transposedPos;
+    StateListPtr transposedStates = StateListPtr(new std::deque<StateInfo>(1));
+    transposedPos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &transposedStates->back(), uiThread.get());
+    apply_moves_to_board({"e2e4", "e7e5", "d2d4", "d7d5", "e4d5", "g8f6"}, transposedPos, transposedStates);
+    REQUIRE(transposedPos.hash_key() == pos.hash_key());
+    leafNode.restore_moves_and_policy(&transposedPos);
+    REQUIRE(leafNode.is_compressed() == false);
+    REQUIRE(leafNode.get_number_child_nodes() == numberChildNodes);
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        const Move move = leafNode.get_move(idx);
+        REQUIRE(priors.find(move) != priors.end());
+        REQUIRE(abs(leafNode.get_policy_prob_small()[idx] - priors[move]) <= priors[move] / 2048);
+        if (idx != 0) {
+            // the restored moves are ordered by their encoding
+            REQUIRE(leafNode.get_move(idx - 1) < move);
+        }
+    }
+
+    // a checkmate is detected once the moves have been generated
+    pos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &states->back(), uiThread.get());
+    apply_moves_to_board({"f2f3", "e7e5", "g2g4", "d8h4"}, pos, states);
+    Node mateNode(&pos, true, &rootNode, 0, &searchSettings);
+    REQUIRE(mateNode.is_terminal() == false);
+    mateNode.generate_deferred_moves(&pos);
+    REQUIRE(mateNode.is_terminal() == true);
+    REQUIRE(mateNode.get_value() == LOSS);
+}
+
+TEST_CASE("Truncated_Policy_Expansion"){
+    init();
+    SearchSettings searchSettings;
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateListPtr states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &states->back(), uiThread.get());
+    Node rootNode(&pos, false, nullptr, 0, &searchSettings);
+    apply_moves_to_board({"e2e4", "d7d5", "e4d5", "e7e5", "d2d4", "g8f6"}, pos, states);
+    Node node(&pos, false, &rootNode, 0, &searchSettings);
+    const size_t numberChildNodes = node.get_number_child_nodes();
+    REQUIRE(numberChildNodes > PRESERVED_ITEMS);
+
+    // the priors halve from move to move, so 90% of the policy mass is covered by fewer than PRESERVED_ITEMS moves
+    unordered_map<Move, float> priors;
+    DynamicVector<float>& policy = node.get_policy_prob_small();
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        policy[idx] = pow(0.5f, idx + 1) / (1 - pow(0.5f, numberChildNodes));
+        priors[node.get_move(idx)] = policy[idx];
+    }
+    node.prepare_node_for_visits();
+    node.truncate_policy(0.9f);
+    REQUIRE(node.get_number_child_nodes() == PRESERVED_ITEMS);
+    REQUIRE(node.get_legal_moves().size() == PRESERVED_ITEMS);
+    // the truncated moves still count as unsolved
+    REQUIRE(node.get_number_unsolved_child_nodes() == numberChildNodes);
+
+    node.expand_policy_tail(&pos);
+    REQUIRE(node.get_number_child_nodes() == numberChildNodes);
+    REQUIRE(node.get_number_unsolved_child_nodes() == numberChildNodes);
+    set<Move> expandedMoves;
+    float policyMass = 0;
+    for (size_t idx = 0; idx < numberChildNodes; ++idx) {
+        const Move move = node.get_move(idx);
+        const float prior = node.get_policy_prob_small()[idx];
+        REQUIRE(priors.find(move) != priors.end());
+        expandedMoves.insert(move);
+        policyMass += prior;
+        if (idx < PRESERVED_ITEMS) {
+            REQUIRE(prior == priors[move]);
+        }
+        if (idx != 0) {
+            // the moves remain ordered by their prior
+            REQUIRE(node.get_policy_prob_small()[idx - 1] >= prior);
+        }
+    }
+    REQUIRE(expandedMoves.size() == numberChildNodes);
+    REQUIRE(policyMass == Approx(1.0f));
+}
+
+// expands the child node at the given index and backs up the given value, pos must be at the position of the parent node
+Node* expand_child_node(Node* parentNode, size_t childIdx, float value, Board& pos, StateListPtr& states, HashTable& hashTable, const SearchSettings* searchSettings) {
+    parentNode->increment_no_visit_idx();
+    states->emplace_back();
+    pos.do_move(parentNode->get_move(childIdx), states->back());
+    void* memory = parentNode->allocate_child_memory(childIdx);
+    Node* childNode = memory != nullptr ? new (memory) Node(&pos, false, parentNode, childIdx, searchSettings) :
+                                          new Node(&pos, false, parentNode, childIdx, searchSettings);
+    pos.undo_move(parentNode->get_move(childIdx));
+    childNode->set_value(value);
+    childNode->prepare_node_for_visits();
+    parentNode->add_new_child_node(childNode, childIdx);
+    hashTable.emplace(childNode->hash_key(), childNode);
+    parentNode->apply_virtual_loss_to_child(childIdx, 1);
+    parentNode->revert_virtual_loss_and_update(childIdx, value, 1);
+    return childNode;
+}
+
+TEST_CASE("Compact_Tree"){
+    init();
+    SearchSettings searchSettings;
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateListPtr states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &states->back(), uiThread.get());
+    HashTable hashTable;
+    Node* rootNode = new Node(&pos, false, nullptr, 0, &searchSettings);
+    rootNode->prepare_node_for_visits();
+    hashTable.emplace(rootNode->hash_key(), rootNode);
+
+    // the root node has three expanded child nodes, the first one has two expanded child nodes of its own
+    Node* firstChildNode = expand_child_node(rootNode, 0, 0.5f, pos, states, hashTable, &searchSettings);
+    expand_child_node(rootNode, 1, -0.25f, pos, states, hashTable, &searchSettings);
+    expand_child_node(rootNode, 2, 0.0f, pos, states, hashTable, &searchSettings);
+    states->emplace_back();
+    pos.do_move(rootNode->get_move(0), states->back());
+    expand_child_node(firstChildNode, 0, 0.75f, pos, states, hashTable, &searchSettings);
+    expand_child_node(firstChildNode, 1, -0.5f, pos, states, hashTable, &searchSettings);
+    pos.undo_move(rootNode->get_move(0));
+
+    // the statistics of every node are stored by their hash key
+    struct NodeStatistics {
+        float value;
+        float visits;
+        vector<float> childNumberVisits;
+        vector<float> policy;
+        vector<Move> moves;
+        size_t childIdxForParent;
+        Key parentKey;
+    };
+    unordered_map<Key, NodeStatistics> statistics;
+    auto collect_statistics = [&statistics](Node* node) {
+        const DynamicVector<float> childNumberVisits = node->get_child_number_visits();
+        const DynamicVector<float>& policy = node->get_policy_prob_small();
+        statistics[node->hash_key()] = {node->get_value(), node->get_visits(),
+                                        vector<float>(childNumberVisits.begin(), childNumberVisits.end()),
+                                        vector<float>(policy.begin(), policy.end()), node->get_legal_moves(),
+                                        node->get_child_idx_for_parent(),
+                                        node->get_parent_node() == nullptr ? 0 : node->get_parent_node()->hash_key()};
+    };
+    vector<Node*> oldNodes = {rootNode};
+    for (size_t idx = 0; idx < oldNodes.size(); ++idx) {
+        collect_statistics(oldNodes[idx]);
+        for (Node* childNode : oldNodes[idx]->get_child_nodes()) {
+            if (childNode != nullptr) {
+                oldNodes.push_back(childNode);
+            }
+        }
+    }
+    REQUIRE(oldNodes.size() == 6);
+    merge_local_memory_counters();
+    const int64_t numberNodes = memoryStatistics.get_number_nodes();
+
+    Node* newRootNode = compact_tree(rootNode, hashTable);
+    REQUIRE(newRootNode->get_parent_node() == nullptr);
+    merge_local_memory_counters();
+    REQUIRE(memoryStatistics.get_number_nodes() == numberNodes);
+    REQUIRE(hashTable.size() == oldNodes.size());
+    vector<Node*> newNodes = {newRootNode};
+    for (size_t idx = 0; idx < newNodes.size(); ++idx) {
+        Node* node = newNodes[idx];
+        REQUIRE(statistics.find(node->hash_key()) != statistics.end());
+        const NodeStatistics& nodeStatistics = statistics[node->hash_key()];
+        REQUIRE(node->get_value() == nodeStatistics.value);
+        REQUIRE(node->get_visits() == nodeStatistics.visits);
+        const DynamicVector<float> childNumberVisits = node->get_child_number_visits();
+        REQUIRE(vector<float>(childNumberVisits.begin(), childNumberVisits.end()) == nodeStatistics.childNumberVisits);
+        const DynamicVector<float>& policy = node->get_policy_prob_small();
+        REQUIRE(vector<float>(policy.begin(), policy.end()) == nodeStatistics.policy);
+        REQUIRE(node->get_legal_moves() == nodeStatistics.moves);
+        // the transposition table points to the relocated node
+        REQUIRE(hashTable[node->hash_key()] == node);
+        if (node != newRootNode) {
+            REQUIRE(node->get_child_idx_for_parent() == nodeStatistics.childIdxForParent);
+            REQUIRE(node->get_parent_node()->hash_key() == nodeStatistics.parentKey);
+            REQUIRE(node->get_parent_node()->get_child_node(node->get_child_idx_for_parent()) == node);
+        }
+        for (Node* childNode : node->get_child_nodes()) {
+            if (childNode != nullptr) {
+                newNodes.push_back(childNode);
+            }
+        }
+    }
+    REQUIRE(newNodes.size() == oldNodes.size());
+    delete_subtree_and_hash_entries(newRootNode, hashTable);
+    REQUIRE(hashTable.empty());
+}
+
+TEST_CASE("Child_Blocks"){
+    init();
+    REQUIRE(child_block_index(0) == 0);
+    REQUIRE(child_block_index(PRESERVED_ITEMS - 1) == 0);
+    REQUIRE(child_block_index(PRESERVED_ITEMS) == 1);
+    REQUIRE(child_block_index(2 * PRESERVED_ITEMS - 1) == 1);
+    REQUIRE(child_block_index(2 * PRESERVED_ITEMS) == 2);
+    REQUIRE(child_block_index(4 * PRESERVED_ITEMS - 1) == 2);
+    REQUIRE(child_block_index(4 * PRESERVED_ITEMS) == 3);
+    REQUIRE(child_block_index(300) == NB_CHILD_BLOCKS - 1);
+
+    // every slot can only be claimed once and the block is freed with its last reference
+    merge_local_memory_counters();
+    const int64_t nodeBytes = memoryStatistics.get_bytes(MEM_NODE);
+    ChildBlock* childBlock = ChildBlock::create(8, 8, sizeof(Node));
+    REQUIRE(childBlock->claim_slot(7) == nullptr);
+    void* memory = childBlock->claim_slot(9);
+    REQUIRE(memory != nullptr);
+    REQUIRE(*reinterpret_cast<ChildBlock**>(static_cast<char*>(memory) - NODE_PREFIX_BYTES) == childBlock);
+    REQUIRE(childBlock->claim_slot(9) == nullptr);
+    REQUIRE(childBlock->claim_slot(16) == nullptr);
+    REQUIRE(childBlock->references.load() == 2);
+    childBlock->release();
+    merge_local_memory_counters();
+    REQUIRE(memoryStatistics.get_bytes(MEM_NODE) > nodeBytes);
+    childBlock->release();
+    merge_local_memory_counters();
+    REQUIRE(memoryStatistics.get_bytes(MEM_NODE) == nodeBytes);
+
+    // the 20 child nodes of the starting position are stored in blocks of 8, 8 and 4 slots
+    SearchSettings searchSettings;
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateListPtr states = StateListPtr(new std::deque<StateInfo>(1));
+    pos.set(StartFENs[CRAZYHOUSE_VARIANT], false, CRAZYHOUSE_VARIANT, &states->back(), uiThread.get());
+    HashTable hashTable;
+    const int64_t numberNodes = memoryStatistics.get_number_nodes();
+    Node* rootNode = new Node(&pos, false, nullptr, 0, &searchSettings);
+    rootNode->prepare_node_for_visits();
+    hashTable.emplace(rootNode->hash_key(), rootNode);
+    REQUIRE(rootNode->get_number_child_nodes() == 20);
+    vector<Node*> childNodes;
+    for (size_t childIdx = 0; childIdx < rootNode->get_number_child_nodes(); ++childIdx) {
+        childNodes.push_back(expand_child_node(rootNode, childIdx, 0.0f, pos, states, hashTable, &searchSettings));
+    }
+    for (size_t childIdx = 0; childIdx < childNodes.size(); ++childIdx) {
+        childBlock = *reinterpret_cast<ChildBlock**>(reinterpret_cast<char*>(childNodes[childIdx]) - NODE_PREFIX_BYTES);
+        REQUIRE(childBlock->firstChildIdx == child_block_begin(child_block_index(childIdx)));
+        REQUIRE(childBlock->capacity == (childIdx < 16 ? 8 : 4));
+    }
+    // deleting the tree releases all child blocks
+    delete_subtree_and_hash_entries(rootNode, hashTable);
+    REQUIRE(hashTable.empty());
+    merge_local_memory_counters();
+    REQUIRE(memoryStatistics.get_number_nodes() == numberNodes);
+    REQUIRE(memoryStatistics.get_bytes(MEM_NODE) == nodeBytes);
+}
+
+// network which returns a uniform policy and a draw value for every position
+class UniformNetAPI : public NeuralNetAPI
+{
+public:
+    UniformNetAPI(const string& modelDirectory, unsigned int batchSize):
+        NeuralNetAPI("cpu", 0, batchSize, modelDirectory, false)
+    {
+        isPolicyMap = false;
+    }
+
+    void predict(float* inputPlanes, float* valueOutput, float* probOutputs) override
+    {
+        fill(valueOutput, valueOutput + batchSize, 0.0f);
+        fill(probOutputs, probOutputs + policyOutputLength, 1.0f);
+    }
+
+protected:
+    void load_model() override {}
+    void load_parameters() override {}
+    void bind_executor() override {}
+    void check_if_policy_map() override {}
+};
+
+TEST_CASE("Search_Node_Limit"){
+    init();
+    SearchSettings searchSettings;
+    searchSettings.threads = 4;
+    searchSettings.batchSize = 8;
+    searchSettings.allowEarlyStopping = false;
+    searchSettings.useSolver = false;
+    // the network only needs a model and a parameter file to exist
+    ofstream("node_limit_test.json").close();
+    ofstream("node_limit_test.params").close();
+    UniformNetAPI netSingle("./", 1);
+    vector<unique_ptr<NeuralNetAPI>> netBatches;
+    for (size_t idx = 0; idx < searchSettings.threads; ++idx) {
+        netBatches.emplace_back(make_unique<UniformNetAPI>("./", searchSettings.batchSize));
+    }
+    remove("node_limit_test.json");
+    remove("node_limit_test.params");
+    Constants::init(netSingle.is_policy_map());
+    PlaySettings playSettings;
+    StatesManager states;
+    MCTSAgent agent(&netSingle, netBatches, &searchSettings, &playSettings, &states);
+    auto uiThread = make_shared<Thread>(0);
+
+    // the limits are smaller than, equal to and larger than the combined batches of all threads
+    for (size_t nodes : {2, 5, 32, 100}) {
+        Board pos;
+        pos.set(StartFENs[CHESS_VARIANT], false, CHESS_VARIANT, new StateInfo, uiThread.get());
+        SearchLimits searchLimits;
+        searchLimits.nodes = nodes;
+        EvalInfo evalInfo;
+        agent.clear_game_history();
+        agent.set_search_settings(&pos, &searchLimits, &evalInfo);
+        agent.perform_action();
+        REQUIRE(evalInfo.nodes <= nodes);
+    }
+}
+
+// network which returns the first input value of every position as its value and policy and counts its inferences
+class EchoNetAPI : public NeuralNetAPI
+{
+public:
+    atomic<size_t> numberPredictions;
+
+    EchoNetAPI(const string& modelDirectory, unsigned int batchSize):
+        NeuralNetAPI("cpu", 0, batchSize, modelDirectory, false),
+        numberPredictions(0)
+    {
+        isPolicyMap = false;
+    }
+
+    void predict(float* inputPlanes, float* valueOutput, float* probOutputs) override
+    {
+        for (size_t idx = 0; idx < batchSize; ++idx) {
+            valueOutput[idx] = inputPlanes[idx * NB_VALUES_TOTAL];
+            probOutputs[idx * NB_LABELS] = inputPlanes[idx * NB_VALUES_TOTAL];
+        }
+        ++numberPredictions;
+    }
+
+protected:
+    void load_model() override {}
+    void load_parameters() override {}
+    void bind_executor() override {}
+    void check_if_policy_map() override {}
+};
+
+// sends the given requests of independent clients to the shared batch, every client leaves after its request
+void run_shared_batch_clients(SharedBatch& sharedBatch, const vector<size_t>& requestSizes, vector<vector<float>>& valueOutputs, vector<vector<float>>& probOutputs)
+{
+    sharedBatch.add_clients(requestSizes.size());
+    valueOutputs.assign(requestSizes.size(), vector<float>());
+    probOutputs.assign(requestSizes.size(), vector<float>());
+    vector<thread> clients;
+    for (size_t clientIdx = 0; clientIdx < requestSizes.size(); ++clientIdx) {
+        clients.emplace_back([&, clientIdx]{
+            const size_t numberPositions = requestSizes[clientIdx];
+            vector<float> inputPlanes(numberPositions * NB_VALUES_TOTAL, 0.0f);
+            for (size_t idx = 0; idx < numberPositions; ++idx) {
+                inputPlanes[idx * NB_VALUES_TOTAL] = clientIdx * 10 + idx;
+            }
+            valueOutputs[clientIdx].resize(numberPositions);
+            probOutputs[clientIdx].resize(numberPositions * NB_LABELS);
+            sharedBatch.predict(inputPlanes.data(), valueOutputs[clientIdx].data(), probOutputs[clientIdx].data(), numberPositions);
+            sharedBatch.remove_clients(1);
+        });
+    }
+    for (thread& client : clients) {
+        client.join();
+    }
+}
+
+TEST_CASE("Shared_Batch"){
+    // the network only needs a model and a parameter file to exist
+    ofstream("shared_batch_test.json").close();
+    ofstream("shared_batch_test.params").close();
+    EchoNetAPI net("./", 8);
+    remove("shared_batch_test.json");
+    remove("shared_batch_test.params");
+    // the timeout is never reached, because a batch is evaluated as soon as it can't grow anymore
+    SharedBatch sharedBatch(&net, chrono::seconds(10));
+    const auto start = chrono::steady_clock::now();
+    vector<vector<float>> valueOutputs;
+    vector<vector<float>> probOutputs;
+
+    // the partial requests of three clients are packed into a single batch
+    run_shared_batch_clients(sharedBatch, {1, 2, 3}, valueOutputs, probOutputs);
+    REQUIRE(net.numberPredictions == 1);
+    REQUIRE(sharedBatch.get_average_fill() == Approx(6.0f / 8));
+    for (size_t clientIdx = 0; clientIdx < valueOutputs.size(); ++clientIdx) {
+        for (size_t idx = 0; idx < valueOutputs[clientIdx].size(); ++idx) {
+            REQUIRE(valueOutputs[clientIdx][idx] == clientIdx * 10 + idx);
+            REQUIRE(probOutputs[clientIdx][idx * NB_LABELS] == clientIdx * 10 + idx);
+        }
+    }
+
+    // two requests which don't fit into one batch are evaluated separately
+    run_shared_batch_clients(sharedBatch, {5, 5}, valueOutputs, probOutputs);
+    REQUIRE(net.numberPredictions == 3);
+    REQUIRE(sharedBatch.get_average_fill() == Approx(16.0f / 24));
+    for (size_t clientIdx = 0; clientIdx < valueOutputs.size(); ++clientIdx) {
+        for (size_t idx = 0; idx < valueOutputs[clientIdx].size(); ++idx) {
+            REQUIRE(valueOutputs[clientIdx][idx] == clientIdx * 10 + idx);
+        }
+    }
+    REQUIRE(chrono::steady_clock::now() - start < chrono::seconds(10));
+
+    // a request must fit into a single batch
+    vector<float> inputPlanes(9 * NB_VALUES_TOTAL);
+    REQUIRE_THROWS_AS(sharedBatch.predict(inputPlanes.data(), valueOutputs[0].data(), probOutputs[0].data(), 9), invalid_argument);
+}
+
+TournamentResult make_tournament_result(size_t numberWins, size_t numberDraws, size_t numberLosses) {
+    TournamentResult result;
+    result.numberWins = numberWins;
+    result.numberDraws = numberDraws;
+    result.numberLosses = numberLosses;
+    return result;
+}
+
+TEST_CASE("Tournament_Statistics"){
+    // score 0.7 with a variance of 0.16 per game
+    TournamentResult result = make_tournament_result(60, 20, 20);
+    REQUIRE(result.numberGames() == 100);
+    REQUIRE(result.score() == Approx(0.7f));
+    REQUIRE(result.elo() == Approx(147.19f).epsilon(0.001));
+    REQUIRE(result.elo_error() == Approx(66.01f).epsilon(0.001));
+    REQUIRE(result.llr(0, 10) == Approx(1.7337f).epsilon(0.001));
+
+    // the result of the opponent is mirrored
+    TournamentResult mirroredResult = make_tournament_result(20, 20, 60);
+    REQUIRE(mirroredResult.elo() == Approx(-147.19f).epsilon(0.001));
+    REQUIRE(mirroredResult.elo_error() == Approx(66.01f).epsilon(0.001));
+    REQUIRE(mirroredResult.llr(0, 10) == Approx(-1.8631f).epsilon(0.001));
+
+    TournamentResult evenResult = make_tournament_result(30, 40, 30);
+    REQUIRE(evenResult.elo() == Approx(0.0f).margin(0.001));
+    REQUIRE(evenResult.elo_error() == Approx(53.16f).epsilon(0.001));
+    REQUIRE(evenResult.llr(0, 10) == Approx(-0.0690f).epsilon(0.001));
+
+    // without any variance the LLR stays 0 and the elo is clipped
+    TournamentResult perfectResult = make_tournament_result(10, 0, 0);
+    REQUIRE(perfectResult.elo() == 1000.0f);
+    REQUIRE(perfectResult.llr(0, 10) == 0.0f);
+    REQUIRE(sprt_decision(perfectResult, 0, 10, 0.05f, 0.05f) == SPRT_CONTINUE);
+
+    // the bounds for alpha = beta = 0.05 are +/- log(19) = +/- 2.944
+    REQUIRE(make_tournament_result(338, 400, 262).llr(0, 10) == Approx(2.9835f).epsilon(0.001));
+    REQUIRE(sprt_decision(make_tournament_result(338, 400, 262), 0, 10, 0.05f, 0.05f) == SPRT_ACCEPT_H1);
+    REQUIRE(make_tournament_result(337, 400, 263).llr(0, 10) == Approx(2.8852f).epsilon(0.001));
+    REQUIRE(sprt_decision(make_tournament_result(337, 400, 263), 0, 10, 0.05f, 0.05f) == SPRT_CONTINUE);
+    REQUIRE(make_tournament_result(277, 400, 323).llr(0, 10) == Approx(-2.9063f).epsilon(0.001));
+    REQUIRE(sprt_decision(make_tournament_result(277, 400, 323), 0, 10, 0.05f, 0.05f) == SPRT_CONTINUE);
+    REQUIRE(make_tournament_result(276, 400, 324).llr(0, 10) == Approx(-3.0035f).epsilon(0.001));
+    REQUIRE(sprt_decision(make_tournament_result(276, 400, 324), 0, 10, 0.05f, 0.05f) == SPRT_ACCEPT_H0);
+}
+
+#ifdef USE_RL
+TEST_CASE("Opening_Pool"){
+    init();
+    // the network only needs a model and a parameter file to exist
+    ofstream("opening_pool_test.json").close();
+    ofstream("opening_pool_test.params").close();
+    UniformNetAPI net("./", 4);
+    remove("opening_pool_test.json");
+    remove("opening_pool_test.params");
+    Constants::init(net.is_policy_map());
+
+    OpeningPool pool(&net, 10, 4.0f, 8, 0.0f);
+    StatesManager states;
+    GamePGN gamePGN;
+    // the pool is refilled three times
+    for (size_t gameIdx = 0; gameIdx < 25; ++gameIdx) {
+        gamePGN.new_game();
+        Board* position = pool.next_opening(gamePGN, CHESS_VARIANT, &states);
+        REQUIRE(gamePGN.gameMoves.size() <= 8);
+        REQUIRE(position->game_ply() == int(gamePGN.gameMoves.size()));
+        REQUIRE(MoveList<LEGAL>(*position).size() != 0);
+        // same clean up as after a self play game
+        states.swap_states();
+        states.clear_states();
+        position->set_state_info(new StateInfo);
+        delete position;
+    }
+}
+#endif
+
 #ifdef CHESS_MODE
 TEST_CASE("Chess_Input_Planes"){
     init();
@@ -0,0 +1,277 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: affinity.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "affinity.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+// memory policies of set_mempolicy() (see numaif.h)
+#define MEMPOLICY_DEFAULT 0
+#define MEMPOLICY_PREFERRED 1
+
+/**
+ * @brief parse_cpu_list Parses a CPU list of the form "0-3,8,10-11"
+ */
+static vector<int> parse_cpu_list(const string& cpuList)
+{
+    vector<int> cpus;
+    stringstream ss(cpuList);
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const size_t dashPos = range.find('-');
+        const int first = stoi(range.substr(0, dashPos));
+        const int last = dashPos == string::npos ? first : stoi(range.substr(dashPos + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+struct NumaNode
+{
+    // node id of the operating system
+    int id;
+    vector<int> cpus;
+};
+
+/**
+ * @brief load_numa_topology Reads the CPUs of all NUMA nodes which have CPUs (memory-only nodes are skipped)
+ */
+static vector<NumaNode> load_numa_topology()
+{
+    vector<NumaNode> nodes;
+#ifdef __linux__
+    for (int nodeId = 0; nodeId < 64; ++nodeId) {
+        ifstream cpuListFile("/sys/devices/system/node/node" + to_string(nodeId) + "/cpulist");
+        if (!cpuListFile.is_open()) {
+            continue;
+        }
+        string cpuList;
+        getline(cpuListFile, cpuList);
+        const vector<int> cpus = parse_cpu_list(cpuList);
+        if (!cpus.empty()) {
+            nodes.push_back({nodeId, cpus});
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        // unknown topology: a single node without explicit CPUs
+        nodes.push_back({-1, {}});
+    }
+    return nodes;
+}
+
+static const vector<NumaNode>& get_numa_topology()
+{
+    static const vector<NumaNode> topology = load_numa_topology();
+    return topology;
+}
+
+ThreadAffinity thread_affinity_from_string(const string& value)
+{
+    if (value == "numa_local") {
+        return AFFINITY_NUMA_LOCAL;
+    }
+    if (value == "numa_remote") {
+        return AFFINITY_NUMA_REMOTE;
+    }
+    return AFFINITY_NONE;
+}
+
+const char* thread_affinity_to_string(ThreadAffinity affinity)
+{
+    switch (affinity) {
+    case AFFINITY_NUMA_LOCAL:
+        return "numa_local";
+    case AFFINITY_NUMA_REMOTE:
+        return "numa_remote";
+    default:
+        return "none";
+    }
+}
+
+size_t get_number_numa_nodes()
+{
+    return get_numa_topology().size();
+}
+
+const vector<int>& get_numa_node_cpus(size_t numaNode)
+{
+    return get_numa_topology()[numaNode % get_number_numa_nodes()].cpus;
+}
+
+#ifdef __linux__
+// true if the calling thread has been restricted to a subset of the CPUs or a memory node
+static thread_local bool isPinned = false;
+
+/**
+ * @brief to_cpu_set Converts a CPU list into a cpu_set_t (all CPUs if the list is empty)
+ */
+static cpu_set_t to_cpu_set(const vector<int>& cpus)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (cpus.empty()) {
+        const long numberCPUs = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < numberCPUs && cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    return cpuSet;
+}
+
+/**
+ * @brief set_cpu_affinity Restricts the calling thread to the given CPUs or to all CPUs if the list is empty
+ */
+static void set_cpu_affinity(const vector<int>& cpus)
+{
+    const cpu_set_t cpuSet = to_cpu_set(cpus);
+    sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+}
+
+/**
+ * @brief set_memory_node Sets the preferred memory node of the calling thread
+ * @param nodeId Node id of the operating system (-1: default policy)
+ */
+static void set_memory_node(int nodeId)
+{
+    if (nodeId < 0) {
+        syscall(SYS_set_mempolicy, MEMPOLICY_DEFAULT, nullptr, 0);
+        return;
+    }
+    unsigned long nodeMask = 1UL << nodeId;
+    syscall(SYS_set_mempolicy, MEMPOLICY_PREFERRED, &nodeMask, sizeof(nodeMask) * 8);
+}
+#endif
+
+int set_thread_affinity(ThreadAffinity affinity, size_t numaNode)
+{
+    const size_t numberNodes = get_number_numa_nodes();
+#ifdef __linux__
+    if (affinity == AFFINITY_NONE || get_numa_node_cpus(0).empty()) {
+        if (isPinned) {
+            set_cpu_affinity({});
+            set_memory_node(-1);
+            isPinned = false;
+        }
+        return -1;
+    }
+    const size_t cpuNode = numaNode % numberNodes;
+    const size_t memoryNode = affinity == AFFINITY_NUMA_REMOTE ? (cpuNode + 1) % numberNodes : cpuNode;
+    set_cpu_affinity(get_numa_node_cpus(cpuNode));
+    set_memory_node(get_numa_topology()[memoryNode].id);
+    isPinned = true;
+    return int(memoryNode);
+#else
+    (void)affinity;
+    (void)numaNode;
+    (void)numberNodes;
+    return -1;
+#endif
+}
+
+static vector<int> load_available_cpus()
+{
+    vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpuSet)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+const vector<int>& get_available_cpus()
+{
+    static const vector<int> cpus = load_available_cpus();
+    return cpus;
+}
+
+CorePartition partition_cores(size_t searchCores)
+{
+    CorePartition partition;
+    const vector<int>& cpus = get_available_cpus();
+    if (cpus.size() < 2) {
+        return partition;
+    }
+    searchCores = min(max(searchCores, size_t(1)), cpus.size() - 1);
+    partition.searchCpus.assign(cpus.begin(), cpus.begin() + searchCores);
+    partition.inferenceCpus.assign(cpus.begin() + searchCores, cpus.end());
+    return partition;
+}
+
+void pin_thread_to_cpus(const vector<int>& cpus)
+{
+#ifdef __linux__
+    set_cpu_affinity(cpus);
+    if (isPinned) {
+        set_memory_node(-1);
+    }
+    isPinned = !cpus.empty();
+#else
+    (void)cpus;
+#endif
+}
+
+void pin_process_threads(const vector<int>& cpus)
+{
+#ifdef __linux__
+    const cpu_set_t cpuSet = to_cpu_set(cpus);
+    DIR* taskDir = opendir("/proc/self/task");
+    if (taskDir == nullptr) {
+        return;
+    }
+    while (dirent* entry = readdir(taskDir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        sched_setaffinity(pid_t(stoi(entry->d_name)), sizeof(cpuSet), &cpuSet);
+    }
+    closedir(taskDir);
+#else
+    (void)cpus;
+#endif
+}
@@ -0,0 +1,115 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: affinity.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Optional placement of threads and their memory on NUMA nodes (Linux only, without a libnuma dependency).
+ * The topology is read from /sys/devices/system/node, the CPU affinity is set by sched_setaffinity()
+ * and the preferred memory node of the calling thread by the set_mempolicy() system call.
+ * All functions are no-ops on other platforms or on machines with a single NUMA node.
+ * Additionally, the CPUs can be partitioned between the search threads and the worker threads of a CPU inference runtime.
+ */
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum ThreadAffinity {
+    // threads float on all CPUs and memory is allocated on first touch
+    AFFINITY_NONE,
+    // threads are pinned to a NUMA node and allocate their memory on the same node
+    AFFINITY_NUMA_LOCAL,
+    // threads are pinned to a NUMA node and allocate their memory on the next node (only meant for benchmarking)
+    AFFINITY_NUMA_REMOTE
+};
+
+/**
+ * @brief thread_affinity_from_string Converts the UCI option value (none, numa_local, numa_remote) to the enum ThreadAffinity
+ */
+ThreadAffinity thread_affinity_from_string(const string& value);
+
+/**
+ * @brief thread_affinity_to_string Returns a const char* representation for the enum ThreadAffinity
+ */
+const char* thread_affinity_to_string(ThreadAffinity affinity);
+
+/**
+ * @brief get_number_numa_nodes Returns the number of NUMA nodes with CPUs (1 if the topology is unknown)
+ */
+size_t get_number_numa_nodes();
+
+/**
+ * @brief get_numa_node_cpus Returns the CPU indices of the given NUMA node
+ * @param numaNode NUMA node index
+ */
+const vector<int>& get_numa_node_cpus(size_t numaNode);
+
+/**
+ * @brief set_thread_affinity Pins the calling thread and its memory allocations according to the given affinity.
+ * In case of AFFINITY_NONE, a previously pinned thread is released to all CPUs and the default memory policy.
+ * @param affinity Thread affinity
+ * @param numaNode NUMA node to run on (modulo the number of NUMA nodes)
+ * @return NUMA node which is used for new memory allocations or -1 for the default policy
+ */
+int set_thread_affinity(ThreadAffinity affinity, size_t numaNode);
+
+/**
+ * @brief The CorePartition struct describes a split of the available CPUs between the tree search and the inference runtime
+ */
+struct CorePartition
+{
+    vector<int> searchCpus;
+    vector<int> inferenceCpus;
+};
+
+/**
+ * @brief get_available_cpus Returns the CPUs which the process was allowed to run on at the first call of this function
+ */
+const vector<int>& get_available_cpus();
+
+/**
+ * @brief partition_cores Splits the available CPUs into a group for the search threads and a group for the inference runtime.
+ * The search threads get the first CPUs and at least one CPU is left for each group.
+ * @param searchCores Number of CPUs for the search threads
+ * @return Core partition (both groups are empty if there are less than two CPUs available)
+ */
+CorePartition partition_cores(size_t searchCores);
+
+/**
+ * @brief pin_thread_to_cpus Restricts the calling thread to the given CPUs (all CPUs if the list is empty)
+ * and resets its memory policy
+ */
+void pin_thread_to_cpus(const vector<int>& cpus);
+
+/**
+ * @brief pin_process_threads Restricts all current threads of the process to the given CPUs.
+ * Threads which are created later on inherit the affinity of their creating thread.
+ * This is used to move the worker threads of the inference runtime, which aren't accessible otherwise.
+ */
+void pin_process_threads(const vector<int>& cpus);
+
+#endif // AFFINITY_H
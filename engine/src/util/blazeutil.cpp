@@ -24,3 +24,55 @@
  */
 
 #include "blazeutil.h"
+#include <cstring>
+
+uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+    const uint32_t mantissa = bits & 0x7fffff;
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        // subnormal half precision number
+        const int shift = 14 - exponent;
+        return sign | (((mantissa | 0x800000) + (1u << (shift - 1))) >> shift);
+    }
+    // a carry of the rounding increments the exponent which still yields the correct result
+    return sign | ((uint32_t(exponent) << 10) + ((mantissa + 0x1000) >> 13));
+}
+
+float half_to_float(uint16_t half)
+{
+    const uint32_t sign = uint32_t(half & 0x8000) << 16;
+    int exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | (uint32_t(exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign;
+    }
+    else {
+        // normalize the subnormal half precision number
+        exponent = 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (uint32_t(exponent - 15 + 127) << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
@@ -245,4 +245,18 @@ void apply_permutation_in_place(std::vector<T>& vec, const std::vector<std::size
     }
 }
 
+/**
+ * @brief float_to_half Converts a single precision number into the IEEE 754 half precision format (rounding to nearest)
+ * @param value Given number
+ * @return Bit representation of the half precision number
+ */
+uint16_t float_to_half(float value);
+
+/**
+ * @brief half_to_float Converts a number in IEEE 754 half precision format into single precision
+ * @param half Bit representation of the half precision number
+ * @return Single precision number
+ */
+float half_to_float(uint16_t half);
+
 #endif // BLAZEUTIL_H
@@ -0,0 +1,398 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: hugepages.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "hugepages.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// small blocks (nodes, node data, hash table entries) use a fine granularity
+constexpr size_t BLOCK_ALIGNMENT = 16;
+constexpr size_t MAX_SMALL_BLOCK_SIZE = 512;
+constexpr size_t NB_SMALL_SIZE_CLASSES = MAX_SMALL_BLOCK_SIZE / BLOCK_ALIGNMENT;
+// medium blocks (child blocks of sibling nodes) use a coarse granularity
+constexpr size_t MEDIUM_BLOCK_ALIGNMENT = 512;
+// larger requests (e.g. the buckets of the hash table) are served by the default heap or by separate mappings
+constexpr size_t MAX_BLOCK_SIZE = 64 * 1024;
+constexpr size_t NB_SIZE_CLASSES = NB_SMALL_SIZE_CLASSES + (MAX_BLOCK_SIZE - MAX_SMALL_BLOCK_SIZE) / MEDIUM_BLOCK_ALIGNMENT;
+// number of blocks which are exchanged between a thread cache and the shared free lists at once
+constexpr size_t TRANSFER_BATCH = 64;
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+struct MemoryRange
+{
+    char* begin;
+    char* end;
+};
+
+inline size_t size_class(size_t bytes)
+{
+    if (bytes <= MAX_SMALL_BLOCK_SIZE) {
+        return (bytes + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT - 1;
+    }
+    return NB_SMALL_SIZE_CLASSES + (bytes - 1) / MEDIUM_BLOCK_ALIGNMENT - 1;
+}
+
+inline size_t block_size(size_t sizeClass)
+{
+    if (sizeClass < NB_SMALL_SIZE_CLASSES) {
+        return (sizeClass + 1) * BLOCK_ALIGNMENT;
+    }
+    return (sizeClass - NB_SMALL_SIZE_CLASSES + 2) * MEDIUM_BLOCK_ALIGNMENT;
+}
+
+/**
+ * @brief The HugePageArena class manages the reserved address range, the shared free lists and the large allocations
+ */
+class HugePageArena
+{
+private:
+    char* base;
+    size_t reservedBytes;
+    size_t committedBytes;
+    bool explicitPagesAvailable;
+    size_t explicitChunks;
+    size_t transparentChunks;
+    atomic<bool> enabled;
+
+    mutex mtx;
+    FreeBlock* freeLists[NB_SIZE_CLASSES];
+    size_t freeCounts[NB_SIZE_CLASSES];
+    // unused remainders of the chunks of finished threads
+    vector<MemoryRange> spareRanges;
+    unordered_map<void*, size_t> largeAllocations;
+
+    /**
+     * @brief commit_chunk Maps the next 2 MB of the reserved range. Expects the mutex to be locked.
+     * @return Start of the chunk or nullptr if the reserved range is exhausted
+     */
+    char* commit_chunk();
+
+public:
+    HugePageArena();
+
+    bool reserve();
+    bool is_reserved() const { return base != nullptr; }
+    bool is_enabled() const { return enabled.load(memory_order_relaxed); }
+    void set_enabled(bool value) { enabled.store(value, memory_order_relaxed); }
+    bool owns(const void* ptr) const { return ptr >= base && ptr < base + reservedBytes; }
+
+    /**
+     * @brief next_range Returns a new memory range for the bump allocation of a thread
+     */
+    bool next_range(MemoryRange& range);
+    void return_range(const MemoryRange& range);
+
+    /**
+     * @brief acquire_blocks Moves up to TRANSFER_BATCH free blocks of the given size class into the given list
+     * @return Number of moved blocks
+     */
+    size_t acquire_blocks(size_t sizeClass, FreeBlock*& list);
+
+    /**
+     * @brief release_blocks Moves the first number blocks of the given list into the shared free list
+     */
+    void release_blocks(size_t sizeClass, FreeBlock*& list, size_t number);
+
+    void* allocate_large(size_t bytes);
+    bool deallocate_large(void* ptr);
+
+    friend void print_huge_page_statistics(ostream& os);
+};
+
+/**
+ * @brief get_arena Returns the global arena which is never destroyed, so tree objects may be freed during the static destruction
+ */
+static HugePageArena& get_arena()
+{
+    static HugePageArena* arena = new HugePageArena();
+    return *arena;
+}
+
+/**
+ * @brief The ThreadCache struct holds the free lists and the current bump range of a single thread
+ */
+struct ThreadCache
+{
+    FreeBlock* freeLists[NB_SIZE_CLASSES] = {};
+    size_t freeCounts[NB_SIZE_CLASSES] = {};
+    MemoryRange range = {nullptr, nullptr};
+
+    ~ThreadCache() {
+        HugePageArena& arena = get_arena();
+        for (size_t idx = 0; idx < NB_SIZE_CLASSES; ++idx) {
+            arena.release_blocks(idx, freeLists[idx], freeCounts[idx]);
+        }
+        if (range.begin != range.end) {
+            arena.return_range(range);
+        }
+    }
+};
+
+static thread_local ThreadCache threadCache;
+
+HugePageArena::HugePageArena():
+    base(nullptr),
+    reservedBytes(0),
+    committedBytes(0),
+    explicitPagesAvailable(true),
+    explicitChunks(0),
+    transparentChunks(0),
+    enabled(false),
+    freeLists(),
+    freeCounts()
+{
+}
+
+bool HugePageArena::reserve()
+{
+#ifdef __linux__
+    // the tree can't grow beyond the physical memory, so its size is reserved as address space without committing it
+    const size_t physicalBytes = size_t(sysconf(_SC_PHYS_PAGES)) * size_t(sysconf(_SC_PAGESIZE));
+    const size_t bytes = (physicalBytes / HUGE_PAGE_SIZE + 1) * HUGE_PAGE_SIZE;
+    void* reserved = mmap(nullptr, bytes + HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) {
+        return false;
+    }
+    // align the start to the huge page size
+    const size_t offset = (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(reserved) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    base = static_cast<char*>(reserved) + offset;
+    reservedBytes = bytes;
+    return true;
+#else
+    return false;
+#endif
+}
+
+char* HugePageArena::commit_chunk()
+{
+#ifdef __linux__
+    if (committedBytes + HUGE_PAGE_SIZE > reservedBytes) {
+        return nullptr;
+    }
+    char* chunk = base + committedBytes;
+    if (explicitPagesAvailable &&
+            mmap(chunk, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) != MAP_FAILED) {
+        ++explicitChunks;
+    }
+    else {
+        // no (more) explicit huge pages: fall back to regular pages which the kernel may merge into transparent huge pages
+        explicitPagesAvailable = false;
+        if (mmap(chunk, HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+            return nullptr;
+        }
+        madvise(chunk, HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+        ++transparentChunks;
+    }
+    committedBytes += HUGE_PAGE_SIZE;
+    return chunk;
+#else
+    return nullptr;
+#endif
+}
+
+bool HugePageArena::next_range(MemoryRange& range)
+{
+    lock_guard<mutex> lock(mtx);
+    if (!spareRanges.empty()) {
+        range = spareRanges.back();
+        spareRanges.pop_back();
+        return true;
+    }
+    char* chunk = commit_chunk();
+    if (chunk == nullptr) {
+        return false;
+    }
+    range = {chunk, chunk + HUGE_PAGE_SIZE};
+    return true;
+}
+
+void HugePageArena::return_range(const MemoryRange& range)
+{
+    lock_guard<mutex> lock(mtx);
+    spareRanges.push_back(range);
+}
+
+size_t HugePageArena::acquire_blocks(size_t sizeClass, FreeBlock*& list)
+{
+    lock_guard<mutex> lock(mtx);
+    size_t number = 0;
+    while (freeLists[sizeClass] != nullptr && number < TRANSFER_BATCH) {
+        FreeBlock* block = freeLists[sizeClass];
+        freeLists[sizeClass] = block->next;
+        block->next = list;
+        list = block;
+        ++number;
+    }
+    freeCounts[sizeClass] -= number;
+    return number;
+}
+
+void HugePageArena::release_blocks(size_t sizeClass, FreeBlock*& list, size_t number)
+{
+    if (number == 0) {
+        return;
+    }
+    FreeBlock* first = list;
+    FreeBlock* last = list;
+    for (size_t idx = 1; idx < number; ++idx) {
+        last = last->next;
+    }
+    list = last->next;
+    lock_guard<mutex> lock(mtx);
+    last->next = freeLists[sizeClass];
+    freeLists[sizeClass] = first;
+    freeCounts[sizeClass] += number;
+}
+
+void* HugePageArena::allocate_large(size_t bytes)
+{
+#ifdef __linux__
+    const size_t mappedBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void* ptr = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    madvise(ptr, mappedBytes, MADV_HUGEPAGE);
+    lock_guard<mutex> lock(mtx);
+    largeAllocations[ptr] = mappedBytes;
+    return ptr;
+#else
+    (void)bytes;
+    return nullptr;
+#endif
+}
+
+bool HugePageArena::deallocate_large(void* ptr)
+{
+#ifdef __linux__
+    size_t mappedBytes;
+    {
+        lock_guard<mutex> lock(mtx);
+        auto it = largeAllocations.find(ptr);
+        if (it == largeAllocations.end()) {
+            return false;
+        }
+        mappedBytes = it->second;
+        largeAllocations.erase(it);
+    }
+    munmap(ptr, mappedBytes);
+    return true;
+#else
+    (void)ptr;
+    return false;
+#endif
+}
+
+bool set_huge_pages(bool enable)
+{
+    HugePageArena& arena = get_arena();
+    if (enable && !arena.is_reserved() && !arena.reserve()) {
+        arena.set_enabled(false);
+        return false;
+    }
+    arena.set_enabled(enable);
+    return enable;
+}
+
+bool huge_pages_enabled()
+{
+    return get_arena().is_enabled();
+}
+
+void* allocate_tree_memory(size_t bytes)
+{
+    HugePageArena& arena = get_arena();
+    if (!arena.is_enabled()) {
+        return ::operator new(bytes);
+    }
+    if (bytes > MAX_BLOCK_SIZE) {
+        void* ptr = bytes >= HUGE_PAGE_SIZE ? arena.allocate_large(bytes) : nullptr;
+        return ptr != nullptr ? ptr : ::operator new(bytes);
+    }
+    const size_t sizeClass = size_class(bytes);
+    ThreadCache& cache = threadCache;
+    if (cache.freeLists[sizeClass] == nullptr) {
+        cache.freeCounts[sizeClass] += arena.acquire_blocks(sizeClass, cache.freeLists[sizeClass]);
+    }
+    if (cache.freeLists[sizeClass] != nullptr) {
+        FreeBlock* block = cache.freeLists[sizeClass];
+        cache.freeLists[sizeClass] = block->next;
+        --cache.freeCounts[sizeClass];
+        return block;
+    }
+    const size_t blockSize = block_size(sizeClass);
+    if (size_t(cache.range.end - cache.range.begin) < blockSize && !arena.next_range(cache.range)) {
+        // the reserved address range is exhausted
+        return ::operator new(bytes);
+    }
+    void* ptr = cache.range.begin;
+    cache.range.begin += blockSize;
+    return ptr;
+}
+
+void deallocate_tree_memory(void* ptr, size_t bytes)
+{
+    HugePageArena& arena = get_arena();
+    if (arena.owns(ptr)) {
+        const size_t sizeClass = size_class(bytes);
+        ThreadCache& cache = threadCache;
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = cache.freeLists[sizeClass];
+        cache.freeLists[sizeClass] = block;
+        // blocks which are freed by a different thread (e.g. when deleting old subtrees) are passed on to the allocating threads
+        if (++cache.freeCounts[sizeClass] > 2 * TRANSFER_BATCH) {
+            arena.release_blocks(sizeClass, cache.freeLists[sizeClass], TRANSFER_BATCH);
+            cache.freeCounts[sizeClass] -= TRANSFER_BATCH;
+        }
+        return;
+    }
+    if (bytes >= HUGE_PAGE_SIZE && arena.deallocate_large(ptr)) {
+        return;
+    }
+    ::operator delete(ptr);
+}
+
+void print_huge_page_statistics(ostream& os)
+{
+    HugePageArena& arena = get_arena();
+    lock_guard<mutex> lock(arena.mtx);
+    os << "info string hugepages " << (arena.is_enabled() ? "on" : "off")
+       << " explicit " << arena.explicitChunks
+       << " transparent " << arena.transparentChunks
+       << " committedmb " << arena.committedBytes / (1024 * 1024);
+}
@@ -0,0 +1,103 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: hugepages.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Optional allocator for the search tree (nodes, node data and hash table entries) which is backed by 2 MB pages.
+ * Fewer and larger pages reduce the TLB misses while traversing trees of several gigabytes.
+ * The memory is carved from a reserved virtual address range in chunks of 2 MB. Every chunk is mapped by an explicit
+ * huge page (MAP_HUGETLB) if the system provides them, otherwise transparent huge pages are requested by madvise().
+ * If neither is available (or on non-Linux platforms), the default heap is used.
+ * Blocks up to 64 KB are served from thread local free lists per size class, freed blocks are reused but not returned to the system.
+ */
+
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <cstddef>
+#include <iostream>
+
+using namespace std;
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * @brief set_huge_pages Enables or disables the huge page backed allocation for all following tree allocations.
+ * The address range is reserved at the first activation. Blocks which were allocated before a change are freed correctly.
+ * @param enable True, if huge pages shall be used
+ * @return True, if huge pages are used from now on (false if the address range couldn't be reserved)
+ */
+bool set_huge_pages(bool enable);
+
+/**
+ * @brief huge_pages_enabled Returns true if new tree allocations are served by huge pages
+ */
+bool huge_pages_enabled();
+
+/**
+ * @brief allocate_tree_memory Allocates memory for a tree object (from huge pages if enabled)
+ * @param bytes Number of bytes
+ * @return Pointer to the memory which is aligned to at least 16 bytes
+ */
+void* allocate_tree_memory(size_t bytes);
+
+/**
+ * @brief deallocate_tree_memory Frees memory which was allocated by allocate_tree_memory()
+ * @param ptr Pointer to the memory
+ * @param bytes Number of bytes which were requested at the allocation
+ */
+void deallocate_tree_memory(void* ptr, size_t bytes);
+
+/**
+ * @brief print_huge_page_statistics Prints the number of chunks which are backed by explicit and transparent huge pages
+ * in accordance with the UCI-protocol (info string ...)
+ */
+void print_huge_page_statistics(ostream& os);
+
+/**
+ * @brief The TreeAllocator struct is a stateless standard allocator which forwards to allocate_tree_memory(),
+ * e.g. for the nodes and buckets of the hash table
+ */
+template<typename T>
+struct TreeAllocator
+{
+    typedef T value_type;
+
+    TreeAllocator() = default;
+    template<typename U>
+    TreeAllocator(const TreeAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(allocate_tree_memory(n * sizeof(T)));
+    }
+    void deallocate(T* ptr, size_t n) {
+        deallocate_tree_memory(ptr, n * sizeof(T));
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const TreeAllocator<T>&, const TreeAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const TreeAllocator<T>&, const TreeAllocator<U>&) { return false; }
+
+#endif // HUGEPAGES_H
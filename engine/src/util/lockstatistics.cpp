@@ -0,0 +1,120 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: lockstatistics.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "lockstatistics.h"
+#include <iomanip>
+
+LockStatistics lockStatistics;
+thread_local LockCounters localLockCounters;
+
+LockCounters::LockCounters()
+{
+    reset();
+}
+
+LockCounters::~LockCounters()
+{
+    lockStatistics.merge(*this);
+}
+
+void LockCounters::reset()
+{
+    for (size_t idx = 0; idx < NB_LOCK_CLASSES; ++idx) {
+        acquisitions[idx] = 0;
+        contentions[idx] = 0;
+        waitTimeNS[idx] = 0;
+    }
+}
+
+LockStatistics::LockStatistics()
+{
+    reset();
+}
+
+void LockStatistics::reset()
+{
+    for (size_t idx = 0; idx < NB_LOCK_CLASSES; ++idx) {
+        acquisitions[idx] = 0;
+        contentions[idx] = 0;
+        waitTimeNS[idx] = 0;
+    }
+}
+
+void LockStatistics::merge(const LockCounters& counters)
+{
+    for (size_t idx = 0; idx < NB_LOCK_CLASSES; ++idx) {
+        acquisitions[idx] += counters.acquisitions[idx];
+        contentions[idx] += counters.contentions[idx];
+        waitTimeNS[idx] += counters.waitTimeNS[idx];
+    }
+}
+
+void merge_local_lock_counters()
+{
+#ifdef LOCK_PROFILING
+    lockStatistics.merge(localLockCounters);
+    localLockCounters.reset();
+#endif
+}
+
+const char* lock_class_to_string(LockClass lockClass)
+{
+    switch(lockClass) {
+    case LOCK_ROOT_NODE:
+        return "root";
+    case LOCK_SHALLOW_NODE:
+        return "depth1-2";
+    case LOCK_DEEP_NODE:
+        return "deeper";
+    case LOCK_HASH_TABLE:
+        return "hashtable";
+    default:
+        return "unknown";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const LockStatistics& stats)
+{
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+    for (size_t idx = 0; idx < NB_LOCK_CLASSES; ++idx) {
+        const size_t acquisitions = stats.acquisitions[idx];
+        const size_t contentions = stats.contentions[idx];
+        const size_t waitTimeNS = stats.waitTimeNS[idx];
+        os << "info string lock " << setw(9) << lock_class_to_string(LockClass(idx))
+           << " acquisitions " << acquisitions
+           << " contentions " << contentions
+           << " (" << (acquisitions == 0 ? 0.0f : 100.0f * contentions / acquisitions) << "%)"
+           << " waitms " << waitTimeNS / 1e6
+           << " avgwaitus " << (contentions == 0 ? 0.0 : waitTimeNS / 1e3 / contentions);
+        if (idx+1 < NB_LOCK_CLASSES) {
+            os << endl;
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
@@ -0,0 +1,134 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: lockstatistics.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Optional instrumentation of the node and hash table mutexes (enabled by the LOCK_PROFILING definition).
+ * Every thread counts its lock acquisitions, contention events and waiting times in thread local storage.
+ * The thread local counters are merged into the global statistics when the thread exits,
+ * so the shared counters are only accessed once per thread and don't falsify the measurement.
+ */
+
+#ifndef LOCKSTATISTICS_H
+#define LOCKSTATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <iostream>
+
+using namespace std;
+
+enum LockClass : uint8_t {
+    LOCK_ROOT_NODE,
+    LOCK_SHALLOW_NODE,  // nodes at depth 1 and 2
+    LOCK_DEEP_NODE,
+    LOCK_HASH_TABLE,
+    NB_LOCK_CLASSES
+};
+
+/**
+ * @brief The LockCounters struct stores the lock statistics of a single thread
+ */
+struct LockCounters
+{
+    size_t acquisitions[NB_LOCK_CLASSES];
+    size_t contentions[NB_LOCK_CLASSES];
+    size_t waitTimeNS[NB_LOCK_CLASSES];
+
+    LockCounters();
+    ~LockCounters();
+
+    void reset();
+};
+
+/**
+ * @brief The LockStatistics class accumulates the lock counters of all finished threads
+ */
+class LockStatistics
+{
+private:
+    atomic<size_t> acquisitions[NB_LOCK_CLASSES];
+    atomic<size_t> contentions[NB_LOCK_CLASSES];
+    atomic<size_t> waitTimeNS[NB_LOCK_CLASSES];
+
+public:
+    LockStatistics();
+
+    /**
+     * @brief reset Sets all counters to zero. Should be called before the search threads are started.
+     */
+    void reset();
+
+    /**
+     * @brief merge Adds the counters of a single thread to the global statistics
+     * @param counters Thread local counters
+     */
+    void merge(const LockCounters& counters);
+
+    /**
+     * @brief operator << Prints a summary for each lock class in accordance with the UCI-protocol (info string ...)
+     */
+    friend std::ostream& operator<<(std::ostream& os, const LockStatistics& stats);
+};
+
+extern LockStatistics lockStatistics;
+extern thread_local LockCounters localLockCounters;
+
+/**
+ * @brief merge_local_lock_counters Merges the lock counters of the calling thread into the global statistics and resets them.
+ * Must be called at the end of a search by threads which outlive the search (e.g. workers of a thread pool).
+ * Does nothing if LOCK_PROFILING isn't defined.
+ */
+void merge_local_lock_counters();
+
+/**
+ * @brief lock_class_to_string Returns a const char* representation for the enum LockClass
+ * @param lockClass Lock class
+ * @return const char*
+ */
+const char* lock_class_to_string(LockClass lockClass);
+
+/**
+ * @brief profiled_lock Locks the given mutex. If LOCK_PROFILING is defined the acquisition is counted for the given lock class
+ * and the time is measured in case the mutex was already held by a different thread.
+ * @param mtx Mutex to lock
+ * @param lockClass Class which is used for the statistics
+ */
+template<typename Mutex>
+inline void profiled_lock(Mutex& mtx, LockClass lockClass)
+{
+#ifdef LOCK_PROFILING
+    ++localLockCounters.acquisitions[lockClass];
+    if (mtx.try_lock()) {
+        return;
+    }
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    mtx.lock();
+    ++localLockCounters.contentions[lockClass];
+    localLockCounters.waitTimeNS[lockClass] += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+#else
+    mtx.lock();
+#endif
+}
+
+#endif // LOCKSTATISTICS_H
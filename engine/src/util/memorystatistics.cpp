@@ -0,0 +1,161 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: memorystatistics.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "memorystatistics.h"
+#include <iomanip>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+MemoryStatistics memoryStatistics;
+thread_local MemoryCounters localMemoryCounters;
+
+MemoryCounters::MemoryCounters()
+{
+    reset();
+}
+
+MemoryCounters::~MemoryCounters()
+{
+    memoryStatistics.merge(*this);
+}
+
+void MemoryCounters::reset()
+{
+    for (size_t idx = 0; idx < NB_MEMORY_CLASSES; ++idx) {
+        bytes[idx] = 0;
+    }
+    numberNodes = 0;
+    unmergedBytes = 0;
+}
+
+MemoryStatistics::MemoryStatistics():
+    numberNodes(0)
+{
+    for (size_t idx = 0; idx < NB_MEMORY_CLASSES; ++idx) {
+        bytes[idx] = 0;
+    }
+}
+
+void MemoryStatistics::merge(MemoryCounters& counters)
+{
+    for (size_t idx = 0; idx < NB_MEMORY_CLASSES; ++idx) {
+        if (counters.bytes[idx] != 0) {
+            bytes[idx].fetch_add(counters.bytes[idx], memory_order_relaxed);
+        }
+    }
+    numberNodes.fetch_add(counters.numberNodes, memory_order_relaxed);
+    counters.reset();
+}
+
+void merge_local_memory_counters()
+{
+    memoryStatistics.merge(localMemoryCounters);
+}
+
+int64_t MemoryStatistics::get_bytes(MemoryClass memoryClass) const
+{
+    return bytes[memoryClass].load(memory_order_relaxed);
+}
+
+int64_t MemoryStatistics::get_total_bytes() const
+{
+    int64_t totalBytes = 0;
+    for (size_t idx = 0; idx < NB_MEMORY_CLASSES; ++idx) {
+        totalBytes += get_bytes(MemoryClass(idx));
+    }
+    return totalBytes;
+}
+
+int64_t MemoryStatistics::get_number_nodes() const
+{
+    return numberNodes.load(memory_order_relaxed);
+}
+
+bool MemoryStatistics::is_memory_critical(float fraction) const
+{
+    const size_t physicalMemory = get_physical_memory();
+    return physicalMemory != 0 && get_total_bytes() > fraction * physicalMemory;
+}
+
+const char* memory_class_to_string(MemoryClass memoryClass)
+{
+    switch(memoryClass) {
+    case MEM_NODE:
+        return "node";
+    case MEM_NODE_DATA:
+        return "nodedata";
+    case MEM_LEGAL_MOVES:
+        return "legalmoves";
+    case MEM_POLICY:
+        return "policy";
+    case MEM_STATE_INFO:
+        return "stateinfo";
+    case MEM_HASH_TABLE:
+        return "hashtable";
+    default:
+        return "unknown";
+    }
+}
+
+size_t get_physical_memory()
+{
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return status.ullTotalPhys;
+    }
+    return 0;
+#else
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || pageSize <= 0) {
+        return 0;
+    }
+    return size_t(pages) * size_t(pageSize);
+#endif
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryStatistics& stats)
+{
+    const int64_t totalBytes = stats.get_total_bytes();
+    const int64_t numberNodes = stats.get_number_nodes();
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(1)
+       << "memory total " << totalBytes / (1024.0 * 1024.0) << "MB"
+       << " nodes " << numberNodes
+       << " bytespernode " << (numberNodes == 0 ? 0 : totalBytes / numberNodes);
+    for (size_t idx = 0; idx < NB_MEMORY_CLASSES; ++idx) {
+        os << ' ' << memory_class_to_string(MemoryClass(idx)) << ' ' << stats.get_bytes(MemoryClass(idx)) / (1024.0 * 1024.0) << "MB";
+    }
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
@@ -0,0 +1,141 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: memorystatistics.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Byte-level accounting of the search tree which is updated incrementally whenever memory is allocated or freed.
+ * Every thread accumulates its changes locally and merges them into the shared counters once they exceed MEMORY_MERGE_BYTES,
+ * so the shared counters lag behind by at most MEMORY_MERGE_BYTES per thread.
+ */
+
+#ifndef MEMORYSTATISTICS_H
+#define MEMORYSTATISTICS_H
+
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+
+enum MemoryClass : uint8_t {
+    MEM_NODE,
+    MEM_NODE_DATA,
+    MEM_LEGAL_MOVES,
+    MEM_POLICY,
+    MEM_STATE_INFO,
+    MEM_HASH_TABLE,
+    NB_MEMORY_CLASSES
+};
+
+// approximated size of a single hash table entry (key-value pair, next pointer and cached hash code)
+template<typename Map>
+constexpr size_t hash_table_entry_bytes() {
+    return sizeof(typename Map::value_type) + 2 * sizeof(void*);
+}
+
+// amount of allocated and freed bytes after which the local changes of a thread are merged into the shared counters
+const int64_t MEMORY_MERGE_BYTES = 1 << 20;
+
+/**
+ * @brief The MemoryCounters struct stores the not yet merged memory changes of a single thread
+ */
+struct MemoryCounters
+{
+    int64_t bytes[NB_MEMORY_CLASSES];
+    int64_t numberNodes;
+    // sum of the allocated and freed bytes since the last merge
+    int64_t unmergedBytes;
+
+    MemoryCounters();
+    ~MemoryCounters();
+
+    void reset();
+};
+
+extern thread_local MemoryCounters localMemoryCounters;
+
+class MemoryStatistics
+{
+private:
+    atomic<int64_t> bytes[NB_MEMORY_CLASSES];
+    atomic<int64_t> numberNodes;
+
+public:
+    MemoryStatistics();
+
+    inline void add(MemoryClass memoryClass, int64_t numberBytes) {
+        localMemoryCounters.bytes[memoryClass] += numberBytes;
+        localMemoryCounters.unmergedBytes += numberBytes < 0 ? -numberBytes : numberBytes;
+        if (localMemoryCounters.unmergedBytes >= MEMORY_MERGE_BYTES) {
+            merge(localMemoryCounters);
+        }
+    }
+
+    inline void add_nodes(int64_t number) {
+        localMemoryCounters.numberNodes += number;
+    }
+
+    /**
+     * @brief merge Adds the given local changes to the shared counters and resets them
+     */
+    void merge(MemoryCounters& counters);
+
+    int64_t get_bytes(MemoryClass memoryClass) const;
+    int64_t get_total_bytes() const;
+    int64_t get_number_nodes() const;
+
+    /**
+     * @brief is_memory_critical Returns true if the accounted memory exceeds the given fraction of the physical memory
+     * @param fraction Fraction of the physical memory, e.g. 0.9
+     * @return bool
+     */
+    bool is_memory_critical(float fraction) const;
+
+    /**
+     * @brief operator << Prints the total amount of memory, the bytes per node and the memory of each class
+     */
+    friend std::ostream& operator<<(std::ostream& os, const MemoryStatistics& stats);
+};
+
+extern MemoryStatistics memoryStatistics;
+
+/**
+ * @brief merge_local_memory_counters Merges the memory changes of the calling thread into the shared counters.
+ * Must be called at the end of a search by threads which outlive the search (e.g. workers of a thread pool)
+ * and before the counters are read for a report.
+ */
+void merge_local_memory_counters();
+
+/**
+ * @brief memory_class_to_string Returns a const char* representation for the enum MemoryClass
+ * @param memoryClass Memory class
+ * @return const char*
+ */
+const char* memory_class_to_string(MemoryClass memoryClass);
+
+/**
+ * @brief get_physical_memory Returns the total amount of physical memory in bytes or 0 if it cannot be determined
+ * @return size_t
+ */
+size_t get_physical_memory();
+
+#endif // MEMORYSTATISTICS_H
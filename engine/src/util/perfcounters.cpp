@@ -0,0 +1,253 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: perfcounters.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "perfcounters.h"
+#include <cstring>
+#include <iomanip>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfValues::PerfValues()
+{
+    reset();
+}
+
+void PerfValues::reset()
+{
+    memset(values, 0, sizeof(values));
+    nodes = 0;
+}
+
+PerfValues& PerfValues::operator+=(const PerfValues& other)
+{
+    for (size_t phase = 0; phase < NB_PERF_PHASES; ++phase) {
+        for (size_t event = 0; event < NB_PERF_EVENTS; ++event) {
+            values[phase][event] += other.values[phase][event];
+        }
+    }
+    nodes += other.nodes;
+    return *this;
+}
+
+#ifdef __linux__
+static int open_perf_event(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    // pid = 0, cpu = -1: measure the calling thread on any cpu
+    return int(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+static void get_event_config(PerfEvent event, uint32_t& type, uint64_t& config)
+{
+    switch (event) {
+    case PERF_CYCLES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_CACHE_MISSES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_BRANCH_MISSES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:  // PERF_LLC_MISSES
+        type = PERF_TYPE_HW_CACHE;
+        config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+}
+#endif
+
+PerfCounters::PerfCounters():
+    leaderFd(-1),
+    nbOpenedEvents(0),
+    currentPhase(PHASE_SELECTION)
+{
+    memset(lastValues, 0, sizeof(lastValues));
+    for (size_t idx = 0; idx < NB_PERF_EVENTS; ++idx) {
+        fds[idx] = -1;
+    }
+#ifdef __linux__
+    for (size_t idx = 0; idx < NB_PERF_EVENTS; ++idx) {
+        uint32_t type;
+        uint64_t config;
+        get_event_config(PerfEvent(idx), type, config);
+        // events which aren't supported by the cpu (e.g. inside of virtual machines) are skipped
+        fds[idx] = open_perf_event(type, config, leaderFd);
+        if (fds[idx] != -1) {
+            if (leaderFd == -1) {
+                leaderFd = fds[idx];
+            }
+            openedEvents[nbOpenedEvents++] = PerfEvent(idx);
+        }
+    }
+    if (leaderFd != -1) {
+        ioctl(leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        read_counters(lastValues);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+bool PerfCounters::read_counters(uint64_t counterValues[NB_PERF_EVENTS]) const
+{
+#ifdef __linux__
+    // layout for PERF_FORMAT_GROUP: number of events followed by the values
+    uint64_t buffer[NB_PERF_EVENTS + 1];
+    if (::read(leaderFd, buffer, sizeof(buffer)) < ssize_t((nbOpenedEvents + 1) * sizeof(uint64_t))) {
+        return false;
+    }
+    for (size_t idx = 0; idx < nbOpenedEvents; ++idx) {
+        counterValues[openedEvents[idx]] = buffer[idx + 1];
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PerfCounters::is_valid() const
+{
+    return leaderFd != -1;
+}
+
+void PerfCounters::switch_phase(PerfPhase phase)
+{
+    if (leaderFd == -1) {
+        return;
+    }
+    uint64_t counterValues[NB_PERF_EVENTS];
+    memset(counterValues, 0, sizeof(counterValues));
+    if (read_counters(counterValues)) {
+        for (size_t idx = 0; idx < NB_PERF_EVENTS; ++idx) {
+            perfValues.values[currentPhase][idx] += counterValues[idx] - lastValues[idx];
+            lastValues[idx] = counterValues[idx];
+        }
+    }
+    currentPhase = phase;
+}
+
+void PerfCounters::close()
+{
+    if (leaderFd == -1) {
+        return;
+    }
+    switch_phase(currentPhase);
+#ifdef __linux__
+    for (size_t idx = 0; idx < NB_PERF_EVENTS; ++idx) {
+        if (fds[idx] != -1) {
+            ::close(fds[idx]);
+            fds[idx] = -1;
+        }
+    }
+#endif
+    leaderFd = -1;
+}
+
+PerfValues& PerfCounters::get_perf_values()
+{
+    return perfValues;
+}
+
+const char* perf_event_to_string(PerfEvent event)
+{
+    switch (event) {
+    case PERF_CYCLES:
+        return "cycles";
+    case PERF_INSTRUCTIONS:
+        return "instructions";
+    case PERF_CACHE_MISSES:
+        return "cachemisses";
+    case PERF_BRANCH_MISSES:
+        return "branchmisses";
+    case PERF_LLC_MISSES:
+        return "llcmisses";
+    default:
+        return "unknown";
+    }
+}
+
+const char* perf_phase_to_string(PerfPhase phase)
+{
+    switch (phase) {
+    case PHASE_SELECTION:
+        return "selection";
+    case PHASE_ENCODING:
+        return "encoding";
+    case PHASE_INFERENCE:
+        return "inference";
+    case PHASE_BACKUP:
+        return "backup";
+    default:
+        return "unknown";
+    }
+}
+
+void print_perf_report(const vector<PerfValues>& threadValues)
+{
+    cout << endl << "Performance counters per 1000 nodes" << endl;
+    cout << "----------------------" << endl;
+    cout << setw(8) << "thread" << setw(11) << "phase";
+    for (size_t event = 0; event < NB_PERF_EVENTS; ++event) {
+        cout << setw(14) << perf_event_to_string(PerfEvent(event));
+    }
+    cout << endl;
+    for (size_t threadIdx = 0; threadIdx < threadValues.size(); ++threadIdx) {
+        const PerfValues& perfValues = threadValues[threadIdx];
+        if (perfValues.nodes == 0) {
+            continue;
+        }
+        for (size_t phase = 0; phase < NB_PERF_PHASES; ++phase) {
+            cout << setw(8) << threadIdx << setw(11) << perf_phase_to_string(PerfPhase(phase));
+            for (size_t event = 0; event < NB_PERF_EVENTS; ++event) {
+                cout << setw(14) << perfValues.values[phase][event] * 1000 / perfValues.nodes;
+            }
+            cout << endl;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: perfcounters.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Hardware performance counters of a single thread based on the Linux perf_event_open interface.
+ * The counters are read once at every phase switch and the difference is assigned to the previous phase.
+ * On other platforms or if the access is denied (see /proc/sys/kernel/perf_event_paranoid) the counters stay invalid.
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+enum PerfEvent : uint8_t {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_LLC_MISSES,
+    NB_PERF_EVENTS
+};
+
+enum PerfPhase : uint8_t {
+    PHASE_SELECTION,
+    PHASE_ENCODING,
+    PHASE_INFERENCE,
+    PHASE_BACKUP,
+    NB_PERF_PHASES
+};
+
+/**
+ * @brief The PerfValues struct stores the accumulated counter values for each phase
+ */
+struct PerfValues
+{
+    uint64_t values[NB_PERF_PHASES][NB_PERF_EVENTS];
+    // number of nodes which have been added by the measured thread
+    size_t nodes;
+
+    PerfValues();
+    void reset();
+    PerfValues& operator+=(const PerfValues& other);
+};
+
+/**
+ * @brief The PerfCounters class measures the calling thread. It must be constructed and closed by the thread to measure.
+ */
+class PerfCounters
+{
+private:
+    int fds[NB_PERF_EVENTS];
+    int leaderFd;
+    // maps the position in the group read buffer to the event
+    PerfEvent openedEvents[NB_PERF_EVENTS];
+    size_t nbOpenedEvents;
+    uint64_t lastValues[NB_PERF_EVENTS];
+    PerfPhase currentPhase;
+    PerfValues perfValues;
+
+    /**
+     * @brief read_counters Reads the current values of all opened counters
+     * @param counterValues Output for each event
+     * @return True on success
+     */
+    bool read_counters(uint64_t counterValues[NB_PERF_EVENTS]) const;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief is_valid Returns true if at least one counter could be opened
+     */
+    bool is_valid() const;
+
+    /**
+     * @brief switch_phase Assigns the counter difference since the last switch to the current phase and starts the given phase
+     * @param phase New phase
+     */
+    void switch_phase(PerfPhase phase);
+
+    /**
+     * @brief close Assigns the remaining counts to the current phase and closes all counters
+     */
+    void close();
+
+    PerfValues& get_perf_values();
+};
+
+const char* perf_event_to_string(PerfEvent event);
+const char* perf_phase_to_string(PerfPhase phase);
+
+/**
+ * @brief print_perf_report Prints the counter values of each thread and phase normalized to 1000 nodes
+ * @param threadValues Accumulated values for each search thread
+ */
+void print_perf_report(const vector<PerfValues>& threadValues);
+
+#endif // PERFCOUNTERS_H
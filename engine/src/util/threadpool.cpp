@@ -0,0 +1,82 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: threadpool.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(size_t numberThreads):
+    terminate(false)
+{
+    workers.reserve(numberThreads);
+    for (size_t idx = 0; idx < numberThreads; ++idx) {
+        workers.emplace_back(&ThreadPool::run_worker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        terminate = true;
+    }
+    cv.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run_worker()
+{
+    while (true) {
+        packaged_task<void()> job;
+        {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [this]{ return terminate || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+future<void> ThreadPool::submit(function<void()> job)
+{
+    packaged_task<void()> task(move(job));
+    future<void> result = task.get_future();
+    {
+        lock_guard<mutex> lock(mtx);
+        jobs.emplace_back(move(task));
+    }
+    cv.notify_one();
+    return result;
+}
+
+size_t ThreadPool::get_number_threads() const
+{
+    return workers.size();
+}
@@ -0,0 +1,86 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: threadpool.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Fixed set of long-lived worker threads which wait on a condition variable for new jobs.
+ * It avoids creating and joining new threads for every search (noticeable for short searches, e.g. bullet games or self play).
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief The ThreadPool class executes the submitted jobs on its worker threads in submission order.
+ * Jobs which wait for each other (e.g. search threads and the thread manager) must not outnumber the worker threads.
+ */
+class ThreadPool
+{
+private:
+    vector<thread> workers;
+    deque<packaged_task<void()>> jobs;
+    mutex mtx;
+    condition_variable cv;
+    bool terminate;
+
+    /**
+     * @brief run_worker Main loop of a worker thread which waits for jobs until the pool is destroyed
+     */
+    void run_worker();
+
+public:
+    /**
+     * @brief ThreadPool Starts the worker threads
+     * @param numberThreads Number of worker threads
+     */
+    explicit ThreadPool(size_t numberThreads);
+
+    /**
+     * @brief ~ThreadPool Finishes all pending jobs and joins the worker threads
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief submit Adds a job to the queue and wakes up an idle worker
+     * @param job Function to execute
+     * @return Future which becomes ready when the job has finished
+     */
+    future<void> submit(function<void()> job);
+
+    size_t get_number_threads() const;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,112 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: tracer.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "tracer.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+Tracer tracer;
+
+// small consecutive ids are easier to read in the timeline than the native thread ids
+static atomic<uint32_t> nextThreadID(0);
+static thread_local uint32_t threadID = ++nextThreadID;
+
+Tracer::Tracer():
+    searchIdx(0),
+    enabled(false)
+{
+}
+
+void Tracer::set_file(const string& fileName)
+{
+    lock_guard<mutex> lock(mtx);
+    enabled = !fileName.empty() && fileName != "<empty>";
+    filePrefix = fileName;
+    // strip the extension because the search index is appended
+    const string extension = ".json";
+    if (filePrefix.size() > extension.size() && filePrefix.compare(filePrefix.size() - extension.size(), extension.size(), extension) == 0) {
+        filePrefix.resize(filePrefix.size() - extension.size());
+    }
+    searchIdx = 0;
+}
+
+bool Tracer::is_enabled() const
+{
+    return enabled.load(memory_order_relaxed);
+}
+
+void Tracer::start_search()
+{
+    lock_guard<mutex> lock(mtx);
+    events.clear();
+    threadNames.clear();
+    searchStart = chrono::steady_clock::now();
+}
+
+void Tracer::set_thread_name(const string& name)
+{
+    if (!enabled) {
+        return;
+    }
+    lock_guard<mutex> lock(mtx);
+    threadNames.emplace_back(threadID, name);
+}
+
+void Tracer::add_span(const char* name, chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end)
+{
+    lock_guard<mutex> lock(mtx);
+    events.push_back({name, threadID, begin, end});
+}
+
+void Tracer::write_search_trace()
+{
+    if (!enabled) {
+        return;
+    }
+    lock_guard<mutex> lock(mtx);
+    const string fileName = filePrefix + "_" + to_string(++searchIdx) + ".json";
+    ofstream file(fileName);
+    if (!file.is_open()) {
+        cerr << "info string Unable to open trace file " << fileName << endl;
+        return;
+    }
+    file << fixed << setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    for (const pair<uint32_t, string>& threadName : threadNames) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadName.first
+             << ",\"args\":{\"name\":\"" << threadName.second << "\"}}";
+        first = false;
+    }
+    for (const TraceEvent& event : events) {
+        file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadID
+             << ",\"ts\":" << chrono::duration<double, micro>(event.begin - searchStart).count()
+             << ",\"dur\":" << chrono::duration<double, micro>(event.end - event.begin).count() << "}";
+        first = false;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}" << endl;
+}
@@ -0,0 +1,133 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018       Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019-2020  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: tracer.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Optional timeline tracing of the search pipeline.
+ * If a trace file is set, the spans of each search (batch creation, inference, backup, thread manager and logger activity)
+ * are collected and written in the Chrome trace-event format which can be opened by chrome://tracing or https://ui.perfetto.dev.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct TraceEvent
+{
+    // the name must have static storage duration
+    const char* name;
+    uint32_t threadID;
+    chrono::steady_clock::time_point begin;
+    chrono::steady_clock::time_point end;
+};
+
+/**
+ * @brief The Tracer class collects the trace events of all threads for a single search
+ */
+class Tracer
+{
+private:
+    mutex mtx;
+    vector<TraceEvent> events;
+    vector<pair<uint32_t, string>> threadNames;
+    chrono::steady_clock::time_point searchStart;
+    string filePrefix;
+    size_t searchIdx;
+    // written by the UCI thread while the search threads are reading it
+    atomic<bool> enabled;
+
+public:
+    Tracer();
+
+    /**
+     * @brief set_file Enables tracing for the given file name. Each search is written to a separate file <name>_<searchIdx>.json.
+     * An empty string or "<empty>" disables tracing.
+     * @param fileName File name of the trace
+     */
+    void set_file(const string& fileName);
+
+    bool is_enabled() const;
+
+    /**
+     * @brief start_search Clears all previous events. Must be called before the search threads are started.
+     */
+    void start_search();
+
+    /**
+     * @brief set_thread_name Assigns a name to the calling thread which is displayed in the timeline
+     * @param name Thread name
+     */
+    void set_thread_name(const string& name);
+
+    /**
+     * @brief add_span Adds a finished span of the calling thread
+     */
+    void add_span(const char* name, chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end);
+
+    /**
+     * @brief write_search_trace Writes all collected events of the current search as a trace-event JSON file
+     */
+    void write_search_trace();
+};
+
+extern Tracer tracer;
+
+/**
+ * @brief The TraceSpan class records the time between its construction and destruction as a span of the calling thread
+ */
+class TraceSpan
+{
+private:
+    const char* name;
+    chrono::steady_clock::time_point begin;
+    bool active;
+
+public:
+    TraceSpan(const char* name):
+        name(name),
+        active(tracer.is_enabled())
+    {
+        if (active) {
+            begin = chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if (active) {
+            tracer.add_span(name, begin, chrono::steady_clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#endif // TRACER_H